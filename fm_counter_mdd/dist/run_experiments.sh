@@ -3,16 +3,27 @@
 OUTPUT_FILE="experiments.csv"
 CTC_REDUCTION=(1 2 5 10 20 50)
 AND_REDUCTION=(0 1 2 5 10 20 50)
+# stop the build internally a bit before the external timeout, so that the row keeps its statistics
+BUDGET="--timeLimit 3540"
+
+# timeout keeps the exit code of FMBuilderExperimenter: when it handles SIGTERM it exits
+# with 6 and has already written its row, when it is killed the status is 128 + signal
+TIMEOUT="timeout --preserve-status -k 120s 3600s"
+
+# true if FMBuilderExperimenter stopped on a budget (exit codes 3-6) and already wrote its row
+stopped_on_budget() {
+	[ $1 -ge 3 ] && [ $1 -le 6 ]
+}
 
 for file in $(ls ../../benchmarks/synthetic/); do
 	for r in ${CTC_REDUCTION[@]}; do
 		for a in ${AND_REDUCTION[@]}; do
 			if [ a == 0 ]; then
-				timeout 3600s ./FMBuilderExperimenter --m ../../benchmarks/synthetic/$file --r $r --o $OUTPUT_FILE --dr || echo -e "../../benchmarks/synthetic/${file};timeout;timeout;${r};0;${a};1;timeout;timeout" >> $OUTPUT_FILE
-				timeout 3600s ./FMBuilderExperimenter --m ../../benchmarks/synthetic/$file --r $r --o $OUTPUT_FILE || echo -e "../../benchmarks/synthetic/${file};timeout;timeout;${r};0;${a};0;timeout;timeout" >> $OUTPUT_FILE
+				$TIMEOUT ./FMBuilderExperimenter --m ../../benchmarks/synthetic/$file --r $r --o $OUTPUT_FILE $BUDGET --dr || stopped_on_budget $? || echo -e "../../benchmarks/synthetic/${file};timeout;timeout;${r};0;${a};1;timeout;timeout" >> $OUTPUT_FILE
+				$TIMEOUT ./FMBuilderExperimenter --m ../../benchmarks/synthetic/$file --r $r --o $OUTPUT_FILE $BUDGET || stopped_on_budget $? || echo -e "../../benchmarks/synthetic/${file};timeout;timeout;${r};0;${a};0;timeout;timeout" >> $OUTPUT_FILE
 			else
-				timeout 3600s ./FMBuilderExperimenter --m ../../benchmarks/synthetic/$file --r $r --o $OUTPUT_FILE --dr --mergeAnd --nMergeAnd $a  || echo -e "../../benchmarks/synthetic/${file};timeout;timeout;${r};1;${a};1;timeout;timeout" >> $OUTPUT_FILE
-				timeout 3600s ./FMBuilderExperimenter --m ../../benchmarks/synthetic/$file --r $r --o $OUTPUT_FILE --mergeAnd --nMergeAnd $a || echo -e "../../benchmarks/synthetic/${file};timeout;timeout;${r};1;${a};0;timeout;timeout" >> $OUTPUT_FILE
+				$TIMEOUT ./FMBuilderExperimenter --m ../../benchmarks/synthetic/$file --r $r --o $OUTPUT_FILE $BUDGET --dr --mergeAnd --nMergeAnd $a || stopped_on_budget $? || echo -e "../../benchmarks/synthetic/${file};timeout;timeout;${r};1;${a};1;timeout;timeout" >> $OUTPUT_FILE
+				$TIMEOUT ./FMBuilderExperimenter --m ../../benchmarks/synthetic/$file --r $r --o $OUTPUT_FILE $BUDGET --mergeAnd --nMergeAnd $a || stopped_on_budget $? || echo -e "../../benchmarks/synthetic/${file};timeout;timeout;${r};1;${a};0;timeout;timeout" >> $OUTPUT_FILE
 			fi
 		done
 	done
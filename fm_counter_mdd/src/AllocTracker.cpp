@@ -0,0 +1,255 @@
+/*
+ * AllocTracker.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "AllocTracker.hpp"
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+
+struct AllocCounters {
+	std::atomic<unsigned long long> allocations;
+	std::atomic<unsigned long long> bytes;
+	std::atomic<unsigned long long> peakLive;
+};
+
+// Names are stored in fixed buffers, so that registering them never calls operator new
+static char phaseNames[ALLOC_MAX_PHASES][32];
+static char categoryNames[ALLOC_MAX_CATEGORIES][32];
+static int nPhases = 1;
+static int nCategories = 1;
+static AllocCounters phases[ALLOC_MAX_PHASES];
+static AllocCounters categories[ALLOC_MAX_CATEGORIES];
+static AllocCounters total;
+static std::atomic<unsigned long long> liveBytes(0);
+static std::atomic<int> currentPhase(0);
+static std::atomic<int> currentCategory(0);
+
+/**
+ * Returns the index of the given name, registering it if needed. Index 0 collects
+ * everything that does not fit (and the allocations outside any phase/category).
+ */
+static int registerName(char names[][32], int &n, int max, const char *name) {
+	for (int i = 1; i < n; i++)
+		if (strncmp(names[i], name, 31) == 0)
+			return i;
+	if (n == max)
+		return 0;
+	strncpy(names[n], name, 31);
+	return n++;
+}
+
+static void updatePeak(std::atomic<unsigned long long> &peak,
+		unsigned long long value) {
+	unsigned long long old = peak.load(std::memory_order_relaxed);
+	while (value > old
+			&& !peak.compare_exchange_weak(old, value, std::memory_order_relaxed))
+		;
+}
+
+#ifdef FM_TRACK_ALLOCATIONS
+
+static void recordAllocation(void *p) {
+	unsigned long long size = malloc_usable_size(p);
+	unsigned long long live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	AllocCounters *counters[3] = { &total, &phases[currentPhase.load(
+			std::memory_order_relaxed)], &categories[currentCategory.load(
+			std::memory_order_relaxed)] };
+	for (AllocCounters *c : counters) {
+		c->allocations.fetch_add(1, std::memory_order_relaxed);
+		c->bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	updatePeak(total.peakLive, live);
+	updatePeak(counters[1]->peakLive, live);
+}
+
+static void* trackedAlloc(std::size_t size, std::size_t alignment) {
+	if (size == 0)
+		size = 1;
+	void *p;
+	if (alignment <= alignof(std::max_align_t)) {
+		p = malloc(size);
+	} else {
+		// aligned_alloc requires the size to be a multiple of the alignment
+		p = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+	}
+	if (p != NULL)
+		recordAllocation(p);
+	return p;
+}
+
+static void trackedFree(void *p) {
+	if (p == NULL)
+		return;
+	liveBytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+	free(p);
+}
+
+void* operator new(std::size_t size) {
+	void *p = trackedAlloc(size, 0);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return trackedAlloc(size, 0);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return trackedAlloc(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	void *p = trackedAlloc(size, (std::size_t) alignment);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void operator delete(void *p) noexcept {
+	trackedFree(p);
+}
+
+void operator delete[](void *p) noexcept {
+	trackedFree(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+	trackedFree(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+	trackedFree(p);
+}
+
+void operator delete(void *p, const std::nothrow_t&) noexcept {
+	trackedFree(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t&) noexcept {
+	trackedFree(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+	trackedFree(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+	trackedFree(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+	trackedFree(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+	trackedFree(p);
+}
+
+#endif
+
+AllocTracker::Scope::Scope(const char *category) {
+	previous = currentCategory.load(std::memory_order_relaxed);
+#ifdef FM_TRACK_ALLOCATIONS
+	currentCategory.store(
+			registerName(categoryNames, nCategories, ALLOC_MAX_CATEGORIES,
+					category), std::memory_order_relaxed);
+#endif
+}
+
+AllocTracker::Scope::~Scope() {
+	currentCategory.store(previous, std::memory_order_relaxed);
+}
+
+/**
+ * Whether the allocations are tracked (i.e., the program has been compiled with
+ * FM_TRACK_ALLOCATIONS)
+ */
+bool AllocTracker::isEnabled() {
+#ifdef FM_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Attributes the next allocations to the given phase
+ *
+ * @param name the name of the phase
+ * @return the previous phase, to be given to leavePhase
+ */
+int AllocTracker::enterPhase(const string &name) {
+	int previous = currentPhase.load(std::memory_order_relaxed);
+#ifdef FM_TRACK_ALLOCATIONS
+	int id = registerName(phaseNames, nPhases, ALLOC_MAX_PHASES, name.c_str());
+	updatePeak(phases[id].peakLive, liveBytes.load(std::memory_order_relaxed));
+	currentPhase.store(id, std::memory_order_relaxed);
+#endif
+	return previous;
+}
+
+/**
+ * Goes back to the phase active before enterPhase
+ *
+ * @param previous the value returned by enterPhase
+ */
+void AllocTracker::leavePhase(int previous) {
+	currentPhase.store(previous, std::memory_order_relaxed);
+}
+
+unsigned long long AllocTracker::getAllocations() {
+	return total.allocations.load();
+}
+
+unsigned long long AllocTracker::getAllocatedBytes() {
+	return total.bytes.load();
+}
+
+unsigned long long AllocTracker::getPeakLiveBytes() {
+	return total.peakLive.load();
+}
+
+static void writeCounters(std::ostream &out, const char *name,
+		const AllocCounters &c, bool peak) {
+	out << "    {\"name\": \"" << name << "\", \"allocations\": "
+			<< c.allocations.load() << ", \"bytes\": " << c.bytes.load();
+	if (peak)
+		out << ", \"peakLiveBytes\": " << c.peakLive.load();
+	out << "}";
+}
+
+/**
+ * Writes the allocation counters as the fields "allocationsByPhase" and
+ * "allocationsByCategory" of a JSON object (each field preceded by a comma)
+ *
+ * @param out the output stream
+ */
+void AllocTracker::writeJson(std::ostream &out) {
+	out << ",\n  \"allocationsByPhase\": [\n";
+	for (int i = 0; i < nPhases; i++) {
+		writeCounters(out, i == 0 ? "other" : phaseNames[i], phases[i], true);
+		out << (i + 1 < nPhases ? ",\n" : "\n");
+	}
+	out << "  ],\n  \"allocationsByCategory\": [\n";
+	for (int i = 0; i < nCategories; i++) {
+		writeCounters(out, i == 0 ? "other" : categoryNames[i], categories[i],
+				false);
+		out << (i + 1 < nCategories ? ",\n" : "\n");
+	}
+	out << "  ]";
+}
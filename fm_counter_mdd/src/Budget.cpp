@@ -0,0 +1,122 @@
+/*
+ * Budget.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "Budget.hpp"
+#include "Metrics.hpp"
+#include "TraceEvents.hpp"
+#include <csignal>
+#include <unistd.h>
+
+double Budget::TIME_LIMIT = 0;
+unsigned long Budget::NODE_LIMIT = 0;
+long Budget::MEMORY_LIMIT_KB = 0;
+double Budget::startTime = 0;
+
+static volatile sig_atomic_t signalReceived = 0;
+
+/**
+ * Terminates the process with the default action of the signal received first, so
+ * that the caller (e.g., timeout) sees a process killed by that signal
+ */
+static void terminateWithDefaultAction(int) {
+	signal(signalReceived, SIG_DFL);
+	raise(signalReceived);
+}
+
+static void onTerminationSignal(int signal) {
+	// The first signal is handled at the next checkpoint, the second one (or the end
+	// of the grace period, if a single operation takes too long) is immediate
+	if (signalReceived) {
+		terminateWithDefaultAction(signal);
+		return;
+	}
+	signalReceived = signal;
+	alarm(BUDGET_SIGNAL_GRACE);
+}
+
+BudgetExceeded::BudgetExceeded(const string &reason, const string &phase) :
+		std::runtime_error(
+				"Build stopped during phase " + phase + ": " + reason
+						+ " budget exhausted"), reason(reason), phase(phase) {
+}
+
+/**
+ * The exit code corresponding to the reason of the stop
+ *
+ * @return one of the BUDGET_EXIT_* codes
+ */
+int BudgetExceeded::getExitCode() const {
+	if (reason == "time")
+		return BUDGET_EXIT_TIME;
+	if (reason == "nodes")
+		return BUDGET_EXIT_NODES;
+	if (reason == "memory")
+		return BUDGET_EXIT_MEMORY;
+	return BUDGET_EXIT_SIGNAL;
+}
+
+/**
+ * Starts counting the time budget
+ */
+void Budget::start() {
+	startTime = Metrics::wallTime();
+}
+
+/**
+ * Turns SIGTERM (sent by timeout) and SIGINT into a graceful stop. If no checkpoint
+ * is reached within BUDGET_SIGNAL_GRACE seconds, the signal takes its default action.
+ * The handlers are only installed when a limit is set (see isActive), otherwise the
+ * checkpoints would never notice the signal.
+ */
+void Budget::installSignalHandlers() {
+	if (!isActive())
+		return;
+	struct sigaction action = { };
+	action.sa_handler = onTerminationSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGTERM, &action, NULL);
+	sigaction(SIGINT, &action, NULL);
+	struct sigaction grace = { };
+	grace.sa_handler = terminateWithDefaultAction;
+	sigemptyset(&grace.sa_mask);
+	sigaction(SIGALRM, &grace, NULL);
+}
+
+/**
+ * Whether the checkpoints have something to check
+ *
+ * @return true if a limit is set
+ */
+bool Budget::isActive() {
+	return TIME_LIMIT > 0 || NODE_LIMIT > 0 || MEMORY_LIMIT_KB > 0;
+}
+
+/**
+ * Seconds (wall-clock) elapsed since start()
+ *
+ * @return the elapsed time in seconds
+ */
+double Budget::elapsed() {
+	return Metrics::wallTime() - startTime;
+}
+
+/**
+ * Checkpoint: throws a BudgetExceeded if a budget is exhausted or a signal has been
+ * received
+ *
+ * @param phase the current phase of the pipeline
+ * @param nodes the number of nodes of the MDD being built
+ */
+void Budget::check(const string &phase, unsigned long nodes) {
+	if (signalReceived)
+		throw BudgetExceeded("signal", phase);
+	if (TIME_LIMIT > 0 && elapsed() > TIME_LIMIT)
+		throw BudgetExceeded("time", phase);
+	if (NODE_LIMIT > 0 && nodes > NODE_LIMIT)
+		throw BudgetExceeded("nodes", phase);
+	if (MEMORY_LIMIT_KB > 0 && TraceEvents::getCurrentRSS() > MEMORY_LIMIT_KB)
+		throw BudgetExceeded("memory", phase);
+}
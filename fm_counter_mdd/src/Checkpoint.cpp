@@ -0,0 +1,204 @@
+/*
+ * Checkpoint.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "Checkpoint.hpp"
+#include "Metrics.hpp"
+#include "Util.hpp"
+#include "logger.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+
+#define CHECKPOINT_MAGIC "fmcheckpoint"
+#define CHECKPOINT_VERSION 2
+
+string Checkpoint::FILE_NAME = "";
+double Checkpoint::INTERVAL = 600;
+string Checkpoint::RESUME_FILE = "";
+string Checkpoint::model = "";
+int Checkpoint::reductionFactor = 0;
+vector<int> Checkpoint::bounds;
+vector<unsigned long> Checkpoint::constraintSizes;
+double Checkpoint::lastSave = 0;
+
+/**
+ * Sets the parameters of the build, written in (and checked against) the checkpoints
+ *
+ * @param model the file name of the model
+ * @param reductionFactor the constraint reduction factor
+ * @param bounds the bounds of the variables
+ * @param N the number of variables
+ */
+void Checkpoint::setContext(const string &model, int reductionFactor,
+		const int *bounds, int N) {
+	Checkpoint::model = model;
+	Checkpoint::reductionFactor = reductionFactor;
+	Checkpoint::bounds.assign(bounds, bounds + N);
+	lastSave = Metrics::wallTime();
+}
+
+/**
+ * Sets the cross-tree constraints of the build, written in (and checked against) the
+ * checkpoints
+ *
+ * @param sizes the number of nodes of each constraint, in the order they are applied
+ */
+void Checkpoint::setConstraints(const vector<unsigned long> &sizes) {
+	constraintSizes = sizes;
+}
+
+bool Checkpoint::isEnabled() {
+	return !FILE_NAME.empty();
+}
+
+/**
+ * Whether a checkpoint should be written now
+ *
+ * @return true if checkpoints are enabled and INTERVAL seconds have passed since the last one
+ */
+bool Checkpoint::isDue() {
+	return isEnabled() && Metrics::wallTime() - lastSave >= INTERVAL;
+}
+
+/**
+ * Writes a checkpoint to FILE_NAME
+ *
+ * @param root the root of the MDD built so far
+ * @param nextConstraint the index of the next constraint to be applied
+ * @param elapsed the seconds spent applying the constraints so far
+ */
+void Checkpoint::save(const dd_edge &root, unsigned int nextConstraint,
+		double elapsed) {
+	forest *mdd = root.getForest();
+	const int N = bounds.size();
+	string tmpName = FILE_NAME + ".tmp";
+	{
+		ofstream out(tmpName, ios::out | ios::trunc);
+		if (!out.is_open())
+			throw std::invalid_argument("Cannot open checkpoint file " + tmpName);
+		out << CHECKPOINT_MAGIC << " " << CHECKPOINT_VERSION << "\n";
+		out << "model " << model << "\n";
+		out << "reduction " << reductionFactor << "\n";
+		out << "constraints " << constraintSizes.size() << " " << nextConstraint;
+		out << "\nsizes";
+		for (unsigned long size : constraintSizes)
+			out << " " << size;
+		out << "\nelapsed " << elapsed << "\n";
+		// The peaks are counts kept in doubles: written as integers, to be read back exactly
+		out << "peaks " << (unsigned long long) Util::N_MAX_NODES << " "
+				<< (unsigned long long) Util::N_MAX_EDGES << "\n";
+		out << "bounds " << N;
+		for (int b : bounds)
+			out << " " << b;
+		// Variable at each level, from the bottom
+		out << "\norder";
+		for (int level = 1; level <= N; level++)
+			out << " " << mdd->getVarByLevel(level);
+		out << "\nmdd\n";
+		ostream_output meddlyOut(out);
+		mdd->writeEdges(meddlyOut, &root, 1);
+		if (!out.good())
+			throw std::runtime_error("Error writing checkpoint file " + tmpName);
+	}
+	if (std::rename(tmpName.c_str(), FILE_NAME.c_str()) != 0)
+		throw std::runtime_error("Cannot rename checkpoint file " + tmpName);
+	lastSave = Metrics::wallTime();
+	LOGCOUT(LOG_INFO) << "Checkpoint saved at constraint " << nextConstraint
+			<< "/" << constraintSizes.size() << endl;
+}
+
+/**
+ * Reads an expected keyword of the checkpoint header
+ */
+static void expect(istream &in, const string &keyword, const string &fileName) {
+	string word;
+	if (!(in >> word) || word != keyword)
+		throw std::invalid_argument(
+				"Invalid checkpoint file " + fileName + ": expected " + keyword);
+}
+
+/**
+ * Loads a checkpoint into the forest of root. The variable order of the forest is set
+ * to the one of the checkpoint before reading the MDD. The constraints (see
+ * setConstraints) must already be compiled and sorted.
+ *
+ * @param fileName the checkpoint file
+ * @param root the edge receiving the MDD
+ * @param elapsed (output) the seconds spent applying the constraints before the checkpoint
+ * @return the index of the next constraint to be applied
+ */
+unsigned int Checkpoint::load(const string &fileName, dd_edge &root,
+		double &elapsed) {
+	ifstream in(fileName);
+	if (!in.is_open())
+		throw std::invalid_argument("Cannot open checkpoint file " + fileName);
+	int version = 0;
+	expect(in, CHECKPOINT_MAGIC, fileName);
+	in >> version;
+	if (version != CHECKPOINT_VERSION)
+		throw std::invalid_argument(
+				"Unsupported checkpoint version in " + fileName);
+
+	string savedModel;
+	int savedReduction;
+	unsigned int nConstraints = 0;
+	unsigned int nextConstraint = 0;
+	unsigned long long peakNodes, peakEdges;
+	expect(in, "model", fileName);
+	in >> ws;
+	getline(in, savedModel);
+	expect(in, "reduction", fileName);
+	in >> savedReduction;
+	expect(in, "constraints", fileName);
+	in >> nConstraints >> nextConstraint;
+	expect(in, "sizes", fileName);
+	vector<unsigned long> savedSizes(in ? nConstraints : 0);
+	for (unsigned long &size : savedSizes)
+		in >> size;
+	expect(in, "elapsed", fileName);
+	in >> elapsed;
+	expect(in, "peaks", fileName);
+	in >> peakNodes >> peakEdges;
+	if (savedModel != model || savedReduction != reductionFactor)
+		throw std::invalid_argument(
+				"Checkpoint " + fileName + " was taken on " + savedModel
+						+ " with reduction factor " + to_string(savedReduction));
+	if (savedSizes != constraintSizes || nextConstraint > nConstraints)
+		throw std::invalid_argument(
+				"The constraints of checkpoint " + fileName
+						+ " do not match the ones compiled from the model");
+	Util::N_MAX_NODES = peakNodes;
+	Util::N_MAX_EDGES = peakEdges;
+
+	expect(in, "bounds", fileName);
+	int N;
+	in >> N;
+	vector<int> savedBounds(N > 0 ? N : 0);
+	for (int &b : savedBounds)
+		in >> b;
+	if (savedBounds != bounds)
+		throw std::invalid_argument(
+				"The variables of checkpoint " + fileName
+						+ " do not match the model");
+
+	expect(in, "order", fileName);
+	vector<int> order(N + 1);
+	order[0] = 0;
+	for (int level = 1; level <= N; level++)
+		in >> order[level];
+	expect(in, "mdd", fileName);
+	if (!in)
+		throw std::invalid_argument("Invalid checkpoint file " + fileName);
+
+	forest *mdd = root.getForest();
+	mdd->reorderVariables(order.data());
+	istream_input meddlyIn(in);
+	mdd->readEdges(meddlyIn, &root, 1);
+	lastSave = Metrics::wallTime();
+	LOGCOUT(LOG_INFO) << "Resumed checkpoint " << fileName << " at constraint "
+			<< nextConstraint << "/" << nConstraints << endl;
+	return nextConstraint;
+}
@@ -7,16 +7,10 @@
 #include "ConstraintVisitor.h"
 
 /**
- * Comparator used for comparing edges in an MDD
- *
- * @param e1 the first edge
- * @param e2 the second edge
- * @return TRUE if the number of edges of the MDD starting with e1 is lower than that of e2,
- *         FALSE otherwise
+ * Whether the textual representation of each constraint has to be collected
+ * (it is needed only by the constraint trace)
  */
-bool compareConstraint(dd_edge e1, dd_edge e2) {
-	return (e1.getEdgeCount() < e2.getEdgeCount());
-}
+bool ConstraintVisitor::COLLECT_INFO = false;
 
 /**
  * Costructor
@@ -30,6 +24,9 @@ ConstraintVisitor::ConstraintVisitor(FeatureVisitor v, const dd_edge &emptyNode,
 	this->visitor = v;
 	this->emptyNode = emptyNode;
 	this->mdd = mdd;
+	this->source = NULL;
+	this->sourcePosition = NULL;
+	this->sourceLine = 1;
 }
 
 /**
@@ -68,60 +65,164 @@ void ConstraintVisitor::visit(xml_node<> *&node, int reduction_factor) {
 			// What to do and how to deal with when the constraint contains an hidden feature???
 			// Now, I'm using emptynode for every variable which is not in the FeatureVisitor lists
 			// but I'm not sure it's the best (and correct) solution
+			++i;
+			ConstraintInfo info;
+			info.rules.push_back(i);
+			info.line = (source != NULL) ? getLine(n->name()) : 0;
+			if (COLLECT_INFO)
+				info.text = toString(n->first_node());
+			double start = Metrics::wallTime();
+			currentSupport.clear();
 			dd_edge c = visitConstraint(n->first_node());
-			double card;
-			apply(CARDINALITY,c, card);
-			logcout(LOG_DEBUG) << "Constraint " << ++i << " cardinality "
-					<< card << endl;
+			info.compileTime = Metrics::wallTime() - start;
+			info.support = currentSupport;
+			if (LOG_ENABLED(LOG_DEBUG)) {
+				double card;
+				apply(CARDINALITY,c, card);
+				LOGCOUT(LOG_DEBUG) << "Constraint " << i << " cardinality "
+						<< card << endl;
+			}
 			constraintMddList.push_back(c);
+			constraintInfoList.push_back(info);
+			Budget::check(PHASE_CTC_COMPILE, 0);
 		}
 	}
 
 	if (reduction_factor > 0) {
+		// The constraints are reordered through a permutation of their indexes, so that
+		// the information about each constraint follows its MDD
+		vector<int> order(constraintMddList.size());
+		for (unsigned int k = 0; k < order.size(); k++)
+			order[k] = k;
+
 		if (Util::SHUFFLE_CONSTRAINTS) {
-			std::shuffle(std::begin(constraintMddList),
-					std::end(constraintMddList), std::random_device());
+			std::shuffle(std::begin(order), std::end(order), std::random_device());
 		} else {
 			// Alternate sort the constraints: the first element is the maximum, then the minimum,
 			// then the second maximum, and so on. In this way, the composition-constraint has
 			// a lower cardinality
-			std::sort(constraintMddList.begin(), constraintMddList.end(), compareConstraint);
-			vector<dd_edge> constraintMddListAlternateSorted;
-			int i = 0, j = constraintMddList.size()-1;
+			vector<unsigned long> edges(constraintMddList.size());
+			for (unsigned int k = 0; k < edges.size(); k++)
+				edges[k] = constraintMddList[k].getEdgeCount();
+			std::sort(order.begin(), order.end(), [&edges](int a, int b) {
+				return edges[a] < edges[b];
+			});
+			vector<int> alternateOrder;
+			int i = 0, j = order.size()-1;
 
 			while (i < j) {
-				constraintMddListAlternateSorted.push_back(constraintMddList[j--]);
-				constraintMddListAlternateSorted.push_back(constraintMddList[i++]);
+				alternateOrder.push_back(order[j--]);
+				alternateOrder.push_back(order[i++]);
 			}
 
 		    // If the total element in array is odd
 		    // then print the last middle element.
-		    if (constraintMddList.size() % 2 != 0) {
-		    	constraintMddListAlternateSorted.push_back(constraintMddList[i]);
+		    if (order.size() % 2 != 0) {
+		    	alternateOrder.push_back(order[i]);
 		    }
 
-			constraintMddList = constraintMddListAlternateSorted;
+			order = alternateOrder;
 		}
 
 		vector<dd_edge> temp;
+		vector<ConstraintInfo> tempInfo;
 
 		// Compact the constraints
-		for (unsigned int i = 0; i < constraintMddList.size(); i +=
+		for (unsigned int i = 0; i < order.size(); i +=
 				reduction_factor) {
-			dd_edge cumulativeNode = constraintMddList[i];
-			logcout(LOG_DEBUG) << "\tReducing constraints from " << (i + 1)
+			dd_edge cumulativeNode = constraintMddList[order[i]];
+			ConstraintInfo cumulativeInfo = constraintInfoList[order[i]];
+			LOGCOUT(LOG_DEBUG) << "\tReducing constraints from " << (i + 1)
 					<< endl;
 			for (int j = 1;
-					j < reduction_factor && i + j < constraintMddList.size();
+					j < reduction_factor && i + j < order.size();
 					j++) {
-				cumulativeNode *= constraintMddList[i + j];
+				double start = Metrics::wallTime();
+				cumulativeNode *= constraintMddList[order[i + j]];
+				cumulativeInfo.merge(constraintInfoList[order[i + j]]);
+				cumulativeInfo.compileTime += Metrics::wallTime() - start;
 			}
 			temp.push_back(cumulativeNode);
+			tempInfo.push_back(cumulativeInfo);
 		}
 
-		logcout(LOG_DEBUG) << "Constraints reduced to " << temp.size() << endl;
+		LOGCOUT(LOG_DEBUG) << "Constraints reduced to " << temp.size() << endl;
 		constraintMddList = temp;
+		constraintInfoList = tempInfo;
+	}
+}
+
+/**
+ * Sets the buffer the XML document has been parsed from, so that the line of each
+ * rule can be reported
+ *
+ * @param source the beginning of the parsed buffer
+ */
+void ConstraintVisitor::setSource(const char *source) {
+	this->source = source;
+	this->sourcePosition = source;
+	this->sourceLine = 1;
+}
+
+/**
+ * Returns the line of the source buffer containing the given position. Rules are
+ * visited in document order, so the buffer is scanned only once.
+ *
+ * @param position a pointer inside the source buffer
+ * @return the line number (starting from 1)
+ */
+int ConstraintVisitor::getLine(const char *position) {
+	if (position < sourcePosition)
+		setSource(source);
+	for (; sourcePosition < position; sourcePosition++)
+		if (*sourcePosition == '\n')
+			sourceLine++;
+	return sourceLine;
+}
+
+/**
+ * Returns a textual (infix) representation of a constraint
+ *
+ * @param node the root of the constraint
+ * @return the string representing the constraint
+ */
+string ConstraintVisitor::toString(xml_node<> *node) {
+	string op;
+	if (strcmp(node->name(), "var") == 0)
+		return node->value();
+	else if (strcmp(node->name(), "not") == 0)
+		return "!" + toString(node->first_node());
+	else if (strcmp(node->name(), "imp") == 0)
+		op = " => ";
+	else if (strcmp(node->name(), "eq") == 0)
+		op = " <=> ";
+	else if (strcmp(node->name(), "disj") == 0)
+		op = " | ";
+	else if (strcmp(node->name(), "conj") == 0)
+		op = " & ";
+	else
+		return node->name();
+
+	string text = "(";
+	for (xml_node<> *n = node->first_node(); n; n = n->next_sibling()) {
+		if (n != node->first_node())
+			text += op;
+		text += toString(n);
 	}
+	return text + ")";
+}
+
+/**
+ * Merges the information of a constraint compacted into this one
+ *
+ * @param other the information of the other constraint
+ */
+void ConstraintInfo::merge(const ConstraintInfo &other) {
+	rules.insert(rules.end(), other.rules.begin(), other.rules.end());
+	if (!other.text.empty())
+		text += " & " + other.text;
+	support.insert(other.support.begin(), other.support.end());
+	compileTime += other.compileTime;
 }
 
 /**
@@ -130,6 +231,7 @@ void ConstraintVisitor::visit(xml_node<> *&node, int reduction_factor) {
  * @param node the node to be visited
  */
 dd_edge ConstraintVisitor::visitConstraint(xml_node<> *node) {
+	AllocTracker::Scope allocScope("constraintEncoder");
 	// Dispatcher, depending on the node type
 	if (strcmp(node->name(), "not") == 0)
 		return visitNot(node);
@@ -251,6 +353,7 @@ dd_edge ConstraintVisitor::visitVar(xml_node<> *node) {
 			&& visitor.variables.count(variableName) > 0) {
 		vector<string> *values = visitor.variables[variableName];
 		int variableIndex = visitor.variableIndex[variableName];
+		currentSupport.insert(variableIndex);
 
 		// Enumerative (if the size is greater than 2 or true/false are not present)
 		if (values->size() > 2
@@ -281,6 +384,7 @@ dd_edge ConstraintVisitor::visitVar(xml_node<> *node) {
 			if (std::find(it->second->begin(), it->second->end(), variableName)
 					!= it->second->end()) {
 				int variableIndex = visitor.variableIndex[it->first];
+				currentSupport.insert(variableIndex);
 				vector<int> constraint(N, -1);
 				// Get the index of the needed value
 				auto itElement = std::find(it->second->begin(),
@@ -299,6 +403,7 @@ dd_edge ConstraintVisitor::visitVar(xml_node<> *node) {
 				visitor.andLeafs.begin(); it != visitor.andLeafs.end(); ++it) {
 			if (it->first == variableName) {
 				int variableIndex = visitor.variableIndex[it->second.first];
+				currentSupport.insert(variableIndex);
 				vector<string> *varValues = visitor.variables[it->second.first];
 				vector<int> constraint(N, -1);
 				dd_edge tempC = emptyNode;
@@ -351,3 +456,12 @@ dd_edge ConstraintVisitor::visitNot(xml_node<> *node) {
 vector<dd_edge> ConstraintVisitor::getConstraintMddList() {
 	return constraintMddList;
 }
+
+/**
+ * Returns the information about the constraints, in the same order of getConstraintMddList()
+ *
+ * @return a vector<ConstraintInfo> with an element for each MDD in the constraint list
+ */
+vector<ConstraintInfo> ConstraintVisitor::getConstraintInfoList() {
+	return constraintInfoList;
+}
@@ -5,6 +5,8 @@
 #include <time.h>
 #include <stdio.h>
 #include "Util.hpp"
+#include "FlatCounter.hpp"
+#include "QueryServer.hpp"
 #include "boost/program_options.hpp"
 
 namespace po = boost::program_options;
@@ -16,6 +18,7 @@ using namespace std;
 #define AUTOVALIDATE "autovalidate"
 #define SILENT "silent"
 #define DONOTGENERATE "donotgenerate"
+#define LOG_RING_CAPACITY 65536
 
 /**
  * Main function, used during testing.
@@ -33,6 +36,54 @@ int main(int argc, char **argv) {
 					("dr", "dinamically reorder variables")
 					("mergeAnd", "merge and groups")
 					("nMergeAnd", po::value<int>(), "threshold for merging and groups [5]")
+					("log", po::value<string>(), "log level: nothing, critical, error, warning, info, debug [info]")
+					("logFile", po::value<string>(), "write the log asynchronously to the given file")
+					("asyncLog", "write the log to stdout through an asynchronous ring buffer")
+					("metrics", po::value<string>(), "write the per-phase metrics of the run to the given JSON file")
+					("metricsCsv", "append the per-phase metrics as extra columns of the output CSV line")
+					("ctcTrace", po::value<string>(), "write a CSV row for each applied cross-tree constraint to the given file")
+					("perf", "sample hardware counters (cycles, instructions, LLC and dTLB misses) for each phase")
+					("trace", po::value<string>(), "write a trace-event JSON file (chrome://tracing, Perfetto) of the build")
+					("levelProfile", po::value<string>(), "write the number of nodes per level at each checkpoint to the given CSV file")
+					("levelProfileEvery", po::value<int>(), "also profile the levels every k cross-tree constraints [0 = only phases and reorderings]")
+					("heartbeat", po::value<double>(), "write a status line every given number of seconds")
+					("statusFile", po::value<string>(), "append the heartbeat status lines to the given file [stderr]")
+					("timeLimit", po::value<double>(), "stop the build after the given number of seconds (checked after each phase and constraint)")
+					("nodeLimit", po::value<unsigned long>(), "stop the build when the MDD exceeds the given number of nodes")
+					("memoryLimit", po::value<long>(), "stop the build when the resident memory exceeds the given number of MB")
+					("checkpoint", po::value<string>(), "periodically save the MDD of the cross-tree phase to the given file")
+					("checkpointEvery", po::value<double>(), "seconds between two checkpoints [600]")
+					("resume", po::value<string>(), "resume the cross-tree phase from the given checkpoint file")
+					("saveMdd", po::value<string>(), "save the final MDD and the variable tables to the given binary file")
+					("loadMdd", po::value<string>(), "count the products of an MDD file written with --saveMdd (no model needed)")
+					("exportFlat", po::value<string>(), "write a flat, memory-mappable snapshot of the final MDD to the given file")
+					("countFlat", po::value<string>(), "count the products of a flat snapshot written with --exportFlat (no model needed)")
+					("threads", po::value<unsigned int>(), "number of threads used on flat snapshots [hardware concurrency]")
+					("countType", po::value<string>(), "number type used by --countFlat: exact, mpz, int128, mod64, double, log [exact]")
+					("assume", po::value<vector<string>>()->composing(), "also count the products under the given feature literals, e.g. \"A !B\" (repeatable)")
+					("assumeFile", po::value<string>(), "also count the products under each line of literals of the given file")
+					("marginals", po::value<string>(), "write the number of products with each feature selected to the given CSV file")
+					("featureReport", po::value<string>(), "write the core, dead and false-optional features to the given CSV file")
+					("pairs", po::value<string>(), "write the pairs of feature literals in no product (or rare, see --pairsRare) to the given CSV file")
+					("pairsRare", po::value<double>(), "also write with --pairs the pairs in at most the given ratio of the products [0]")
+					("sizes", po::value<string>(), "write the number of products with each number of selected concrete features to the given CSV file (features without an MDD variable are not counted)")
+					("minFeatures", po::value<long>(), "count the products with at least the given number of selected concrete features (as in --sizes), printed as min;max;count")
+					("maxFeatures", po::value<long>(), "count the products with at most the given number of selected concrete features (as in --sizes), printed as min;max;count")
+					("samples", po::value<string>(), "write uniform random products (the names of their selected features) to the given file")
+					("sampleCount", po::value<uint64_t>(), "number of products written by --samples [1000]")
+					("sampleSeed", po::value<uint64_t>(), "seed of the random products of --samples [0]")
+					("rank", po::value<vector<string>>()->composing(), "print the rank of the product with the given selected features, e.g. \"A B\" (repeatable)")
+					("unrank", po::value<vector<string>>()->composing(), "print the selected features of the product of the given rank (repeatable)")
+					("rankRange", po::value<string>(), "write the products of the ranks FIRST:LAST (LAST excluded, optional) to the file given with --rankRangeFile")
+					("rankRangeFile", po::value<string>(), "file of the products written by --rankRange")
+					("products", po::value<string>(), "write all the products to the given bit-packed binary file, enumerated in parallel")
+					("productsCsv", po::value<string>(), "also decode the products of --products to the given CSV file (one value per variable)")
+					("productNames", "write the selected feature names, instead of the values, in the CSV file of --productsCsv")
+					("validate", po::value<string>(), "validate the configurations of the given file (one per line, the names of the selected features separated by ; or ,)")
+					("validateReport", po::value<string>(), "CSV file of the invalid configurations found by --validate, with the first violated level")
+					("serve", po::value<string>(), "answer count/validate/marginal queries on the models given with --serveModel over the given Unix socket")
+					("serveModel", po::value<vector<string>>()->composing(), "model served by --serve, as name=flat snapshot file (repeatable)")
+					("serveShutdown", "let the clients of --serve running as the same user stop the server with shutdown")
 					;
 	po::variables_map vm;
 	po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -41,12 +92,180 @@ int main(int argc, char **argv) {
 	string outputPath="";
 	string numProducts = "";
 	int ctcToMerge = 0;
+	int exitCode = 0;
 	ofstream outputFile;
 
 	if (vm.count(HELP)) {
 		cout << desc << "\n";
 		return 0;
 	}
+	// The log options apply to every mode, so they are set before the dispatch below
+	try {
+		if (vm.count("log")) {
+			threshold = parseLogLevel(vm["log"].as<string>());
+		}
+		if (vm.count("logFile")) {
+			startAsyncLogging(vm["logFile"].as<string>(), LOG_RING_CAPACITY);
+		} else if (vm.count("asyncLog")) {
+			startAsyncLogging("", LOG_RING_CAPACITY);
+		}
+	} catch (std::exception &e) {
+		cerr << e.what() << endl;
+		return -1;
+	}
+	if (vm.count("exportFlat")) {
+		Util::FLAT_MDD_FILE = vm["exportFlat"].as<string>();
+	}
+	unsigned int threads = vm.count("threads") ?
+			vm["threads"].as<unsigned int>() : FlatCounter::defaultThreads();
+	FlatReports::THREADS = threads;
+	if (vm.count("marginals")) {
+		FlatReports::MARGINALS_FILE = vm["marginals"].as<string>();
+	}
+	if (vm.count("featureReport")) {
+		FlatReports::FEATURE_CLASSES_FILE = vm["featureReport"].as<string>();
+	}
+	if (vm.count("pairs")) {
+		FlatReports::PAIRS_FILE = vm["pairs"].as<string>();
+	}
+	if (vm.count("pairsRare")) {
+		FlatReports::PAIRS_RARE_RATIO = vm["pairsRare"].as<double>();
+	}
+	if (vm.count("sizes")) {
+		FlatReports::SIZES_FILE = vm["sizes"].as<string>();
+	}
+	if (vm.count("minFeatures")) {
+		FlatReports::MIN_SIZE = vm["minFeatures"].as<long>();
+	}
+	if (vm.count("maxFeatures")) {
+		FlatReports::MAX_SIZE = vm["maxFeatures"].as<long>();
+	}
+	if (vm.count("samples")) {
+		FlatReports::SAMPLES_FILE = vm["samples"].as<string>();
+	}
+	if (vm.count("sampleCount")) {
+		FlatReports::SAMPLE_COUNT = vm["sampleCount"].as<uint64_t>();
+	}
+	if (vm.count("sampleSeed")) {
+		FlatReports::SAMPLE_SEED = vm["sampleSeed"].as<uint64_t>();
+	}
+	if (vm.count("rank")) {
+		for (const string &features : vm["rank"].as<vector<string>>())
+			FlatReports::RANK_QUERIES.push_back(Util::splitLiterals(features));
+	}
+	if (vm.count("unrank")) {
+		FlatReports::UNRANK_QUERIES = vm["unrank"].as<vector<string>>();
+	}
+	if (vm.count("rankRange") != vm.count("rankRangeFile")) {
+		cerr << "--rankRange and --rankRangeFile must be given together" << endl;
+		return -1;
+	}
+	if (vm.count("rankRange")) {
+		const string range = vm["rankRange"].as<string>();
+		const size_t colon = range.find(':');
+		FlatReports::RANGE_FIRST = range.substr(0, colon);
+		if (colon != string::npos)
+			FlatReports::RANGE_LAST = range.substr(colon + 1);
+		FlatReports::RANGE_FILE = vm["rankRangeFile"].as<string>();
+	}
+	if (vm.count("validate") != vm.count("validateReport")) {
+		cerr << "--validate and --validateReport must be given together" << endl;
+		return -1;
+	}
+	if (vm.count("validate")) {
+		FlatReports::VALIDATE_FILE = vm["validate"].as<string>();
+		FlatReports::VALIDATE_REPORT_FILE = vm["validateReport"].as<string>();
+	}
+	if (vm.count("productsCsv") && !vm.count("products")) {
+		cerr << "--productsCsv needs --products" << endl;
+		return -1;
+	}
+	if (vm.count("products")) {
+		FlatReports::PRODUCTS_FILE = vm["products"].as<string>();
+	}
+	if (vm.count("productsCsv")) {
+		FlatReports::PRODUCTS_CSV_FILE = vm["productsCsv"].as<string>();
+	}
+	if (vm.count("productNames")) {
+		FlatReports::PRODUCT_NAMES = true;
+	}
+	if (vm.count("assume")) {
+		for (const string &literals : vm["assume"].as<vector<string>>())
+			Util::ASSUMPTIONS.push_back(Util::splitLiterals(literals));
+	}
+	if (vm.count("assumeFile")) {
+		try {
+			Util::readAssumptions(vm["assumeFile"].as<string>());
+		} catch (std::exception &e) {
+			cerr << e.what() << endl;
+			stopAsyncLogging();
+			return -1;
+		}
+	}
+	if (vm.count("countFlat")) {
+		FlatMdd *flat = NULL;
+		try {
+			flat = FlatMdd::open(vm["countFlat"].as<string>());
+			string countType = vm.count("countType") ?
+					vm["countType"].as<string>() : "exact";
+			cout << FlatCounter::count(*flat, threads, countType) << endl;
+			if (!Util::ASSUMPTIONS.empty()) {
+				vector<ValueMask> masks(Util::ASSUMPTIONS.size());
+				for (size_t k = 0; k < masks.size(); k++)
+					for (const string &literal : Util::ASSUMPTIONS[k])
+						FlatCounter::assume(*flat, literal, masks[k]);
+				vector<string> counts = FlatCounter::countBatch(*flat, threads, masks);
+				for (size_t k = 0; k < masks.size(); k++)
+					cout << Util::joinLiterals(Util::ASSUMPTIONS[k]) << ";" << counts[k]
+							<< endl;
+			}
+			FlatReports::write(*flat);
+		} catch (std::exception &e) {
+			cerr << e.what() << endl;
+			exitCode = -1;
+		}
+		delete flat;
+		stopAsyncLogging();
+		return exitCode;
+	}
+	if (vm.count("serve")) {
+		QueryServer::ALLOW_SHUTDOWN = vm.count("serveShutdown") > 0;
+		try {
+			QueryServer server;
+			if (vm.count("serveModel")) {
+				for (const string &model : vm["serveModel"].as<vector<string>>()) {
+					size_t equal = model.find('=');
+					if (equal == string::npos)
+						throw std::invalid_argument(
+								"Invalid model " + model + ", expected name=file");
+					server.addModel(model.substr(0, equal), model.substr(equal + 1));
+				}
+			}
+			server.run(vm["serve"].as<string>(), threads);
+		} catch (std::exception &e) {
+			cerr << e.what() << endl;
+			exitCode = -1;
+		}
+		stopAsyncLogging();
+		return exitCode;
+	}
+	if (vm.count("loadMdd")) {
+		try {
+			Util::checkOutputFiles();
+			cout << Util::getProductCountFromMddFile(vm["loadMdd"].as<string>())
+					<< endl;
+			if (!Util::writeAnalyses())
+				exitCode = -1;
+		} catch (std::exception &e) {
+			cerr << e.what() << endl;
+			exitCode = -1;
+		} catch (MEDDLY::error &e) {
+			cerr << "Caught meddly error '" << e.getName() << "'" << endl;
+			exitCode = -1;
+		}
+		stopAsyncLogging();
+		return exitCode;
+	}
 	if (vm.count("m")) {
 		path = vm["m"].as<string>();
 	} else {
@@ -80,17 +299,126 @@ int main(int argc, char **argv) {
 	} else {
 		Util::REORDER_VARIABLES=false;
 	}
+	if (vm.count("saveMdd")) {
+		Util::SAVE_MDD_FILE = vm["saveMdd"].as<string>();
+	}
+	if (vm.count("ctcTrace")) {
+		Util::CTC_TRACE_FILE = vm["ctcTrace"].as<string>();
+	}
+	// The files written after the count are checked before the build
+	try {
+		Util::checkOutputFiles();
+	} catch (std::exception &e) {
+		cerr << e.what() << endl;
+		stopAsyncLogging();
+		return -1;
+	}
+	if (vm.count("perf")) {
+		PerfCounters::REQUESTED = true;
+		PerfCounters::open();
+	}
+	if (vm.count("trace")) {
+		TraceEvents::open(vm["trace"].as<string>());
+	}
+	if (vm.count("levelProfile")) {
+		LevelProfiler::open(vm["levelProfile"].as<string>());
+		if (vm.count("levelProfileEvery")) {
+			LevelProfiler::EVERY_K = vm["levelProfileEvery"].as<int>();
+		}
+	}
+	if (vm.count("timeLimit")) {
+		Budget::TIME_LIMIT = vm["timeLimit"].as<double>();
+	}
+	if (vm.count("nodeLimit")) {
+		Budget::NODE_LIMIT = vm["nodeLimit"].as<unsigned long>();
+	}
+	if (vm.count("memoryLimit")) {
+		Budget::MEMORY_LIMIT_KB = vm["memoryLimit"].as<long>() * 1024;
+	}
+	Budget::installSignalHandlers();
+	if (vm.count("checkpoint")) {
+		Checkpoint::FILE_NAME = vm["checkpoint"].as<string>();
+		if (vm.count("checkpointEvery")) {
+			Checkpoint::INTERVAL = vm["checkpointEvery"].as<double>();
+		}
+	}
+	if (vm.count("resume")) {
+		Checkpoint::RESUME_FILE = vm["resume"].as<string>();
+	}
+	if (vm.count("heartbeat")) {
+		Heartbeat::start(vm["heartbeat"].as<double>(),
+				vm.count("statusFile") ? vm["statusFile"].as<string>() : "");
+	}
 	outputFile.open (outputPath, ios::out | ios::app);
 	if (outputFile.is_open()) {
-		double time1, timedif;
+		double time1, timedif, wall1;
 		time1 = (double) clock() / CLOCKS_PER_SEC;
-		numProducts = Util::getProductCountFromFile(path, IGNORE_HIDDEN_MAIN, ctcToMerge);
+		wall1 = Metrics::wallTime();
+		Budget::start();
+		try {
+			numProducts = Util::getProductCountFromFile(path, IGNORE_HIDDEN_MAIN, ctcToMerge);
+			Metrics::setValue("status", "completed");
+		} catch (BudgetExceeded &e) {
+			// The row is written anyway, with the reason in place of the number of products
+			cerr << e.what() << endl;
+			numProducts = e.reason;
+			exitCode = e.getExitCode();
+			Metrics::setValue("status", e.reason);
+			Metrics::setValue("phaseReached", e.phase);
+			Metrics::setValue("peakRSSKb", Metrics::getPeakRSS());
+		} catch (std::exception &e) {
+			// An invalid input (e.g. an unknown feature in --assume) leaves no row
+			cerr << e.what() << endl;
+			outputFile.close();
+			Heartbeat::stop();
+			LevelProfiler::close();
+			TraceEvents::close();
+			PerfCounters::close();
+			stopAsyncLogging();
+			return -1;
+		}
 		timedif = ( ((double) clock()) / CLOCKS_PER_SEC) - time1;
 		outputFile << path << ";" << numProducts << ";" << timedif << ";" << ctcToMerge << ";" <<
 				FeatureVisitor::COMPRESS_AND_VARS << ";" << FeatureVisitor::COMPRESS_AND_THRESHOLD << ";" <<
-				Util::REORDER_VARIABLES << ";" << Util::N_MAX_EDGES << ";" << Util::N_MAX_NODES << "\n";
+				Util::REORDER_VARIABLES << ";" << Util::N_MAX_EDGES << ";" << Util::N_MAX_NODES;
+		if (vm.count("metricsCsv")) {
+			Metrics::writeCsvColumns(outputFile);
+		} else if (PerfCounters::REQUESTED) {
+			Metrics::writePerfCsvColumns(outputFile);
+		}
+		outputFile << "\n";
 		outputFile.close();
+
+		// The analyses of the final MDD come after the row, so their errors cannot lose it
+		try {
+			if (!Util::writeAnalyses())
+				exitCode = -1;
+		} catch (std::exception &e) {
+			cerr << e.what() << endl;
+			exitCode = -1;
+		}
+
+		if (vm.count("metrics")) {
+			Metrics::setValue("model", path);
+			Metrics::setValue("products", numProducts);
+			Metrics::setValue("ctcToMerge", ctcToMerge);
+			Metrics::setValue("mergeAnd", FeatureVisitor::COMPRESS_AND_VARS);
+			Metrics::setValue("nMergeAnd", FeatureVisitor::COMPRESS_AND_THRESHOLD);
+			Metrics::setValue("reorder", Util::REORDER_VARIABLES);
+			Metrics::setValue("maxEdges", Util::N_MAX_EDGES);
+			Metrics::setValue("maxNodes", Util::N_MAX_NODES);
+			Metrics::setValue("totalCpu", timedif);
+			Metrics::setValue("totalWall", Metrics::wallTime() - wall1);
+			ofstream metricsFile(vm["metrics"].as<string>());
+			Metrics::writeJson(metricsFile);
+		}
 	} else {
 		cerr << "Error in locating output file" << endl;
 	}
+	Heartbeat::stop();
+	LevelProfiler::close();
+	TraceEvents::close();
+	PerfCounters::close();
+	stopAsyncLogging();
+	return exitCode;
 }
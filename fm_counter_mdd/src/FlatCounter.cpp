@@ -0,0 +1,528 @@
+/*
+ * FlatCounter.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatCounter.hpp"
+#include "CountNumber.hpp"
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+
+// Number of nodes taken at once by a thread
+#define FLAT_CHUNK 256
+// Number of masks counted together by countBatch
+#define FLAT_BATCH_WIDTH 16
+
+/**
+ * Reusable barrier for a fixed number of threads
+ */
+class LevelBarrier {
+private:
+	std::mutex lock;
+	std::condition_variable released;
+	unsigned int threads;
+	unsigned int waiting;
+	unsigned long generation;
+public:
+	LevelBarrier(unsigned int threads) :
+			threads(threads), waiting(0), generation(0) {
+	}
+
+	void wait() {
+		std::unique_lock<std::mutex> guard(lock);
+		unsigned long current = generation;
+		if (++waiting == threads) {
+			waiting = 0;
+			generation++;
+			released.notify_all();
+		} else {
+			released.wait(guard, [this, current] {
+				return generation != current;
+			});
+		}
+	}
+};
+
+/**
+ * The number of threads used when none is given: the hardware concurrency
+ *
+ * @return the number of threads (at least 1)
+ */
+unsigned int FlatCounter::defaultThreads() {
+	unsigned int n = std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+/**
+ * Calls visit on every non-terminal node, one level at a time. The nodes of a level
+ * are visited concurrently, and a level starts only when the previous one is complete.
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param bottomUp whether the levels go from 1 to N (true) or from N to 1 (false)
+ * @param visit the function called on each node id
+ * @param prepareLevel if set, it is called (by a single thread) before visiting the
+ * 		nodes of each level
+ */
+void FlatCounter::forEachNodeByLevel(const FlatMdd &flat, unsigned int threads,
+		bool bottomUp, const function<void(uint32_t)> &visit,
+		const function<void(uint32_t)> &prepareLevel) {
+	const uint32_t N = flat.getNumVariables();
+	if (threads <= 1) {
+		for (uint32_t k = 1; k <= N; k++) {
+			uint32_t level = bottomUp ? k : N + 1 - k;
+			if (prepareLevel)
+				prepareLevel(level);
+			for (uint32_t n = flat.getLevelStart(level);
+					n < flat.getLevelStart(level + 1); n++)
+				visit(n);
+		}
+		return;
+	}
+
+	LevelBarrier barrier(threads);
+	vector<std::atomic<uint32_t>> next(N + 2);
+	for (uint32_t level = 0; level <= N + 1; level++)
+		next[level] = (level <= N) ? flat.getLevelStart(level) : 0;
+	// The first exception thrown by a thread: the others skip the remaining work but
+	// still reach every barrier, and the exception is rethrown after the join
+	std::exception_ptr error;
+	std::mutex errorLock;
+	std::atomic<bool> failed(false);
+	auto guarded = [&](const function<void()> &work) {
+		if (failed)
+			return;
+		try {
+			work();
+		} catch (...) {
+			std::lock_guard<std::mutex> guard(errorLock);
+			if (!error)
+				error = std::current_exception();
+			failed = true;
+		}
+	};
+	auto worker = [&](bool first) {
+		for (uint32_t k = 1; k <= N; k++) {
+			uint32_t level = bottomUp ? k : N + 1 - k;
+			if (prepareLevel) {
+				if (first)
+					guarded([&] {
+						prepareLevel(level);
+					});
+				barrier.wait();
+			}
+			const uint32_t end = flat.getLevelStart(level + 1);
+			guarded([&] {
+				while (!failed) {
+					uint32_t firstNode = next[level].fetch_add(FLAT_CHUNK);
+					if (firstNode >= end)
+						break;
+					uint32_t last = std::min(firstNode + FLAT_CHUNK, end);
+					for (uint32_t n = firstNode; n < last; n++)
+						visit(n);
+				}
+			});
+			barrier.wait();
+		}
+	};
+	vector<std::thread> pool;
+	for (unsigned int t = 1; t < threads; t++)
+		pool.push_back(std::thread(worker, false));
+	worker(true);
+	for (std::thread &t : pool)
+		t.join();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+/**
+ * The number of assignments of all the variables (the count of the terminal true)
+ *
+ * @param flat the MDD
+ * @return the product of the bounds of the variables
+ */
+mpz_class FlatCounter::domainSize(const FlatMdd &flat) {
+	mpz_class size = 1;
+	for (uint32_t var = 1; var <= flat.getNumVariables(); var++)
+		size *= flat.getBound(var);
+	return size;
+}
+
+/**
+ * Computes the count of every node (see the class description)
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param counts (output) the count of each node id, terminals included
+ */
+void FlatCounter::countNodes(const FlatMdd &flat, unsigned int threads,
+		vector<mpz_class> &counts) {
+	counts.assign(flat.getNumNodes(), 0);
+	counts[FLAT_TRUE] = domainSize(flat);
+	forEachNodeByLevel(flat, threads, true, [&flat, &counts](uint32_t n) {
+		const uint32_t *children = flat.getChildren(n);
+		const uint32_t size = flat.getNumChildren(n);
+		mpz_class &c = counts[n];
+		for (uint32_t i = 0; i < size; i++)
+			if (children[i] != FLAT_FALSE)
+				c += counts[children[i]];
+		mpz_divexact_ui(c.get_mpz_t(), c.get_mpz_t(), size);
+	});
+}
+
+/**
+ * Computes the prefix products of the number of allowed values
+ *
+ * @param flat the MDD
+ * @param mask the allowed values
+ * @param prefix (output) prefix[l] is the product of the number of allowed values of
+ * 		the levels 1..l
+ * @return false if some variable has no allowed value (the count is 0)
+ */
+bool FlatCounter::computePrefixes(const FlatMdd &flat, const ValueMask &mask,
+		vector<mpz_class> &prefix) {
+	const uint32_t N = flat.getNumVariables();
+	prefix.assign(N + 1, 0);
+	prefix[0] = 1;
+	for (uint32_t level = 1; level <= N; level++) {
+		const uint32_t var = flat.getVariableAtLevel(level);
+		const char *allowed = allowedValues(mask, var);
+		unsigned long values = flat.getBound(var);
+		if (allowed != NULL)
+			values = std::count(allowed, allowed + flat.getBound(var), 1);
+		if (values == 0)
+			return false;
+		prefix[level] = prefix[level - 1] * values;
+	}
+	return true;
+}
+
+/**
+ * Computes the level of every node
+ *
+ * @param flat the MDD
+ * @param levelOf (output) the level of each node id (0 for the terminals)
+ */
+void FlatCounter::computeNodeLevels(const FlatMdd &flat,
+		vector<uint32_t> &levelOf) {
+	const uint32_t N = flat.getNumVariables();
+	levelOf.assign(flat.getNumNodes(), 0);
+	for (uint32_t level = 1; level <= N; level++)
+		for (uint32_t n = flat.getLevelStart(level);
+				n < flat.getLevelStart(level + 1); n++)
+			levelOf[n] = level;
+}
+
+/**
+ * Restricts a mask with a feature literal: "name" keeps only the values of the
+ * variable that select the feature, "!name" only those that do not select it
+ *
+ * @param flat the MDD, with its table of features
+ * @param literal the literal
+ * @param mask (input/output) the mask to restrict
+ */
+void FlatCounter::assume(const FlatMdd &flat, const string &literal,
+		ValueMask &mask) {
+	const bool negated = !literal.empty() && literal[0] == '!';
+	const string name = negated ? literal.substr(1) : literal;
+	const int feature = flat.findFeature(name);
+	if (feature < 0)
+		throw std::invalid_argument("Unknown feature: " + name);
+	const uint32_t var = flat.getFeatureVariable(feature);
+	if (mask.empty())
+		mask.resize(flat.getNumVariables() + 1);
+	vector<char> &allowed = mask[var];
+	if (allowed.empty())
+		allowed.assign(flat.getBound(var), 1);
+	vector<char> selecting(flat.getBound(var), 0);
+	const uint32_t *values = flat.getFeatureValues(feature);
+	for (uint32_t i = 0; i < flat.getNumFeatureValues(feature); i++)
+		selecting[values[i]] = 1;
+	for (uint32_t value = 0; value < allowed.size(); value++)
+		if (selecting[value] == negated)
+			allowed[value] = 0;
+}
+
+/**
+ * Marks the levels of the children of the nodes of a level
+ *
+ * @param flat the MDD
+ * @param levelOf the level of each node id
+ * @param level the level of the parents
+ * @param used (output) used[lc] is true if some node of the level has a child at lc
+ */
+void FlatCounter::markChildLevels(const FlatMdd &flat,
+		const vector<uint32_t> &levelOf, uint32_t level, vector<char> &used) {
+	std::fill(used.begin(), used.end(), false);
+	for (uint32_t n = flat.getLevelStart(level);
+			n < flat.getLevelStart(level + 1); n++) {
+		const uint32_t *children = flat.getChildren(n);
+		for (uint32_t i = 0; i < flat.getNumChildren(n); i++)
+			used[levelOf[children[i]]] = true;
+	}
+}
+
+static mpz_class toMpz(unsigned __int128 value) {
+	mpz_class result = (unsigned long) (value >> 64);
+	result <<= 64;
+	result += (unsigned long) value;
+	return result;
+}
+
+static void setMpz(mpz_class &x, unsigned __int128 value) {
+	mpz_import(x.get_mpz_t(), 1, -1, sizeof(value), 0, 0, &value);
+}
+
+/**
+ * Weight of the edges from a level l to the nodes of a lower level lc: the number of
+ * assignments of the skipped levels lc+1..l-1
+ */
+struct SkipWeight {
+	bool small;
+	// Set only if small
+	unsigned __int128 value;
+	mpz_class big;
+};
+
+/**
+ * Counts the products of the MDD with mixed precision.
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param mask the allowed values (the products of a partial configuration)
+ * @return the number of products, in base 10
+ */
+string FlatCounter::count(const FlatMdd &flat, unsigned int threads,
+		const ValueMask &mask) {
+	return countBatch(flat, threads, vector<ValueMask>(1, mask))[0];
+}
+
+/**
+ * Counts the products of the MDD under many masks with mixed precision. The masks are
+ * counted FLAT_BATCH_WIDTH at a time, each group in a single pass over the MDD: every
+ * node stores one count for each mask of the group.
+ *
+ * Here the count of a node is the number of allowed assignments of the levels from 1
+ * to its own level, so it is bounded by the product P(l) of the number of allowed
+ * values of those levels: on the levels where P(l) fits in 128 bits no overflow is
+ * possible and no check is done. Above, sums and products are checked, and a count is
+ * promoted to GMP only when it overflows. Edges skipping levels are multiplied by the
+ * size of the skipped levels, computed once for each pair of levels actually used.
+ *
+ * If the whole domain fits in 128 bits, GMP is never used.
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param masks the allowed values of each query
+ * @return the number of products under each mask, in base 10
+ */
+vector<string> FlatCounter::countBatch(const FlatMdd &flat, unsigned int threads,
+		const vector<ValueMask> &masks) {
+	const uint32_t N = flat.getNumVariables();
+	const size_t nNodes = flat.getNumNodes();
+	const uint32_t root = flat.getRoot();
+	const mpz_class limit = toMpz(~(unsigned __int128) 0);
+	vector<uint32_t> levelOf;
+	computeNodeLevels(flat, levelOf);
+	vector<string> results(masks.size(), "0");
+
+	for (size_t first = 0; first < masks.size(); first += FLAT_BATCH_WIDTH) {
+		const size_t K = std::min((size_t) FLAT_BATCH_WIDTH, masks.size() - first);
+		// Prefix products of each mask, and the levels whose counts surely fit
+		vector<vector<mpz_class>> prefix(K);
+		vector<char> possible(K);
+		vector<char> fits((N + 1) * K);
+		for (size_t k = 0; k < K; k++) {
+			possible[k] = computePrefixes(flat, masks[first + k], prefix[k]);
+			for (uint32_t level = 0; level <= N && possible[k]; level++)
+				fits[level * K + k] = (prefix[k][level] <= limit);
+		}
+
+		// The counts of node n are at n * K + k
+		vector<unsigned __int128> small(nNodes * K, 0);
+		vector<mpz_class*> big(nNodes * K, NULL);
+		for (size_t k = 0; k < K; k++)
+			small[FLAT_TRUE * K + k] = 1;
+		// Weights of the level being visited, indexed by the level of the child
+		vector<SkipWeight> weights((N + 1) * K);
+		vector<char> used(N + 1, false);
+
+		auto prepareLevel = [&](uint32_t level) {
+			markChildLevels(flat, levelOf, level, used);
+			for (uint32_t lc = 0; lc < level; lc++) {
+				if (!used[lc])
+					continue;
+				for (size_t k = 0; k < K; k++) {
+					if (!possible[k])
+						continue;
+					SkipWeight &w = weights[lc * K + k];
+					w.small = fits[(level - 1) * K + k];
+					w.big = prefix[k][level - 1] / prefix[k][lc];
+					w.value = 0;
+					if (w.small)
+						mpz_export(&w.value, NULL, -1, sizeof(w.value), 0, 0,
+								w.big.get_mpz_t());
+				}
+			}
+		};
+
+		auto visit = [&](uint32_t n) {
+			const uint32_t level = levelOf[n];
+			const uint32_t var = flat.getVariableAtLevel(level);
+			const uint32_t *children = flat.getChildren(n);
+			const uint32_t size = flat.getNumChildren(n);
+			static thread_local mpz_class scratch;
+			for (size_t k = 0; k < K; k++) {
+				if (!possible[k])
+					continue;
+				const char *allowed = allowedValues(masks[first + k], var);
+				unsigned __int128 acc = 0;
+				if (fits[level * K + k]) {
+					// No overflow: counts and partial sums are at most the prefix product
+					for (uint32_t i = 0; i < size; i++)
+						if (children[i] != FLAT_FALSE
+								&& (allowed == NULL || allowed[i]))
+							acc += small[children[i] * K + k]
+									* weights[levelOf[children[i]] * K + k].value;
+					small[n * K + k] = acc;
+					continue;
+				}
+				mpz_class *bigAcc = NULL;
+				for (uint32_t i = 0; i < size; i++) {
+					const uint32_t c = children[i];
+					if (c == FLAT_FALSE || (allowed != NULL && !allowed[i]))
+						continue;
+					const SkipWeight &w = weights[levelOf[c] * K + k];
+					const size_t child = c * K + k;
+					if (bigAcc == NULL) {
+						unsigned __int128 term, sum;
+						if (big[child] == NULL && w.small
+								&& !__builtin_mul_overflow(small[child], w.value,
+										&term)
+								&& !__builtin_add_overflow(acc, term, &sum)) {
+							acc = sum;
+							continue;
+						}
+						// Promotion of the count
+						bigAcc = new mpz_class();
+						setMpz(*bigAcc, acc);
+					}
+					if (big[child] == NULL) {
+						setMpz(scratch, small[child]);
+						mpz_addmul(bigAcc->get_mpz_t(), scratch.get_mpz_t(),
+								w.big.get_mpz_t());
+					} else {
+						mpz_addmul(bigAcc->get_mpz_t(), big[child]->get_mpz_t(),
+								w.big.get_mpz_t());
+					}
+				}
+				if (bigAcc != NULL)
+					big[n * K + k] = bigAcc;
+				else
+					small[n * K + k] = acc;
+			}
+		};
+
+		forEachNodeByLevel(flat, threads, true, visit, prepareLevel);
+
+		// The levels above the root are free
+		for (size_t k = 0; k < K && root != FLAT_FALSE; k++) {
+			if (!possible[k])
+				continue;
+			const size_t r = root * K + k;
+			mpz_class result = (big[r] != NULL) ? *big[r] : toMpz(small[r]);
+			result *= prefix[k][N] / prefix[k][levelOf[root]];
+			results[first + k] = result.get_str();
+		}
+		for (mpz_class *b : big)
+			delete b;
+	}
+	return results;
+}
+
+/**
+ * Counts the products of the MDD with the given number type (see CountNumber.hpp).
+ * The count of a node is the number of assignments of the levels from 1 to its own
+ * level, and edges skipping levels are multiplied by the size of the skipped levels.
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param mask the allowed values
+ * @return the number of products, printed by the number type
+ */
+template<class Number>
+string FlatCounter::countAs(const FlatMdd &flat, unsigned int threads,
+		const ValueMask &mask) {
+	typedef typename Number::value_type value_type;
+	const uint32_t N = flat.getNumVariables();
+	vector<mpz_class> prefix;
+	vector<uint32_t> levelOf;
+	if (!computePrefixes(flat, mask, prefix))
+		return Number::toString(Number::zero());
+	computeNodeLevels(flat, levelOf);
+
+	vector<value_type> counts(flat.getNumNodes(), Number::zero());
+	counts[FLAT_TRUE] = Number::one();
+	vector<value_type> weights(N + 1, Number::zero());
+	vector<char> used(N + 1, false);
+
+	auto prepareLevel = [&](uint32_t level) {
+		markChildLevels(flat, levelOf, level, used);
+		for (uint32_t lc = 0; lc < level; lc++)
+			if (used[lc])
+				weights[lc] = Number::fromMpz(prefix[level - 1] / prefix[lc]);
+	};
+	auto visit = [&](uint32_t n) {
+		const uint32_t *children = flat.getChildren(n);
+		const uint32_t size = flat.getNumChildren(n);
+		const char *allowed = allowedValues(mask,
+				flat.getVariableAtLevel(levelOf[n]));
+		value_type acc = Number::zero();
+		for (uint32_t i = 0; i < size; i++)
+			if (children[i] != FLAT_FALSE && (allowed == NULL || allowed[i]))
+				Number::addProduct(acc, counts[children[i]],
+						weights[levelOf[children[i]]]);
+		counts[n] = acc;
+	};
+	forEachNodeByLevel(flat, threads, true, visit, prepareLevel);
+
+	const uint32_t root = flat.getRoot();
+	value_type result = Number::zero();
+	if (root != FLAT_FALSE)
+		Number::addProduct(result, counts[root],
+				Number::fromMpz(prefix[N] / prefix[levelOf[root]]));
+	return Number::toString(result);
+}
+
+/**
+ * Counts the products of the MDD with the number type chosen at runtime
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param numberType exact (mixed precision, see count), mpz,
+ * 		int128, mod64, double or log
+ * @param mask the allowed values
+ * @return the number of products
+ */
+string FlatCounter::count(const FlatMdd &flat, unsigned int threads,
+		const string &numberType, const ValueMask &mask) {
+	if (numberType == "exact")
+		return count(flat, threads, mask);
+	if (numberType == "mpz")
+		return countAs<MpzNumber>(flat, threads, mask);
+	if (numberType == "int128")
+		return countAs<Int128Number>(flat, threads, mask);
+	if (numberType == "mod64")
+		return countAs<Mod64Number>(flat, threads, mask);
+	if (numberType == "double")
+		return countAs<DoubleNumber>(flat, threads, mask);
+	if (numberType == "log")
+		return countAs<LogNumber>(flat, threads, mask);
+	throw std::invalid_argument("Invalid count type: " + numberType);
+}
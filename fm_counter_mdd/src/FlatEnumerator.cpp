@@ -0,0 +1,297 @@
+/*
+ * FlatEnumerator.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatEnumerator.hpp"
+#include "FlatCounter.hpp"
+#include "FlatRanker.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstring>
+
+#define PRODUCTS_MAGIC "FMPROD1"
+#define PRODUCTS_VERSION 1
+// Largest number of products of a task, unless it cannot be split further
+#define TASK_PRODUCTS (1 << 16)
+// Size of the output buffer of the decoder
+#define DECODE_BUFFER (1 << 20)
+
+struct ProductsHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t nVariables;
+	uint64_t recordSize;
+	uint64_t count;
+};
+
+/**
+ * Position of the values of the variables in a record
+ */
+struct RecordLayout {
+	vector<uint32_t> offset;
+	vector<uint32_t> bits;
+	size_t size;
+
+	RecordLayout(const FlatMdd &flat) {
+		const uint32_t N = flat.getNumVariables();
+		offset.assign(N + 1, 0);
+		bits.assign(N + 1, 0);
+		uint32_t position = 0;
+		for (uint32_t var = 1; var <= N; var++) {
+			offset[var] = position;
+			for (uint32_t b = flat.getBound(var) - 1; b > 0; b >>= 1)
+				bits[var]++;
+			position += bits[var];
+		}
+		size = (position + 7) / 8;
+	}
+
+	void set(uint8_t *record, uint32_t var, uint32_t value) const {
+		uint32_t position = offset[var];
+		for (uint32_t remaining = bits[var]; remaining > 0;) {
+			const uint32_t shift = position % 8;
+			const uint32_t taken = std::min(8 - shift, remaining);
+			const uint8_t mask = ((1u << taken) - 1) << shift;
+			record[position / 8] = (record[position / 8] & ~mask)
+					| ((value << shift) & mask);
+			value >>= taken;
+			position += taken;
+			remaining -= taken;
+		}
+	}
+
+	uint32_t get(const uint8_t *record, uint32_t var) const {
+		uint32_t value = 0, position = offset[var];
+		for (uint32_t done = 0; done < bits[var];) {
+			const uint32_t shift = position % 8;
+			const uint32_t taken = std::min(8 - shift, bits[var] - done);
+			value |= ((record[position / 8] >> shift) & ((1u << taken) - 1))
+					<< done;
+			position += taken;
+			done += taken;
+		}
+		return value;
+	}
+};
+
+/**
+ * The products of a cofactor: those through node with the given values of the levels
+ * above level
+ */
+struct EnumerationTask {
+	uint32_t level;
+	uint32_t node;
+	vector<uint32_t> values;
+};
+
+/**
+ * Splits the products through a node in tasks, in order
+ */
+static void splitTasks(const FlatMdd &flat, const FlatRanker &ranker,
+		const vector<uint32_t> &levelOf, uint32_t level, uint32_t node,
+		vector<uint32_t> &values, vector<EnumerationTask> &tasks) {
+	mpz_class products;
+	ranker.completions(level, node, products);
+	if (products == 0)
+		return;
+	if (level == 0 || products <= TASK_PRODUCTS) {
+		tasks.push_back( { level, node, values });
+		return;
+	}
+	const uint32_t var = flat.getVariableAtLevel(level);
+	for (uint32_t i = 0; i < flat.getBound(var); i++) {
+		values[var] = i;
+		splitTasks(flat, ranker, levelOf, level - 1,
+				(level > levelOf[node]) ? node : flat.getChildren(node)[i], values,
+				tasks);
+	}
+}
+
+/**
+ * Appends the records of the products through a node
+ */
+static void enumerate(const FlatMdd &flat, const RecordLayout &layout,
+		const vector<uint32_t> &levelOf, uint32_t level, uint32_t node,
+		uint8_t *record, vector<uint8_t> &out) {
+	if (node == FLAT_FALSE)
+		return;
+	if (level == 0) {
+		out.insert(out.end(), record, record + layout.size);
+		return;
+	}
+	const uint32_t var = flat.getVariableAtLevel(level);
+	const bool skipped = level > levelOf[node];
+	const uint32_t *children = skipped ? NULL : flat.getChildren(node);
+	for (uint32_t i = 0; i < flat.getBound(var); i++) {
+		const uint32_t child = skipped ? node : children[i];
+		if (child == FLAT_FALSE)
+			continue;
+		layout.set(record, var, i);
+		enumerate(flat, layout, levelOf, level - 1, child, record, out);
+	}
+}
+
+/**
+ * Writes all the products as a binary file (see FlatEnumerator)
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param fileName the name of the binary file
+ * @return the number of products written
+ */
+uint64_t FlatEnumerator::writeBinary(const FlatMdd &flat, unsigned int threads,
+		const string &fileName) {
+	ofstream output(fileName, ios::out | ios::binary | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open products file " + fileName);
+	const uint32_t N = flat.getNumVariables();
+	const RecordLayout layout(flat);
+	FlatRanker ranker(flat, threads);
+	vector<uint32_t> levelOf;
+	FlatCounter::computeNodeLevels(flat, levelOf);
+
+	ProductsHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, PRODUCTS_MAGIC, sizeof(PRODUCTS_MAGIC));
+	h.version = PRODUCTS_VERSION;
+	h.nVariables = N;
+	h.recordSize = layout.size;
+	output.write((const char*) &h, sizeof(h));
+	for (uint32_t var = 1; var <= N; var++) {
+		uint32_t bound = flat.getBound(var);
+		output.write((const char*) &bound, sizeof(bound));
+	}
+
+	vector<EnumerationTask> tasks;
+	vector<uint32_t> values(N + 1, 0);
+	splitTasks(flat, ranker, levelOf, N, flat.getRoot(), values, tasks);
+
+	// The tasks are enumerated a round at a time, and written in order
+	const size_t round = 4 * (size_t) threads;
+	for (size_t firstTask = 0; firstTask < tasks.size(); firstTask += round) {
+		const size_t lastTask = std::min(firstTask + round, tasks.size());
+		vector<vector<uint8_t>> buffers(lastTask - firstTask);
+		std::atomic<size_t> next(firstTask);
+		std::exception_ptr error;
+		std::mutex errorLock;
+		auto worker = [&]() {
+			try {
+				vector<uint8_t> record(layout.size + 1, 0);
+				for (size_t t = next++; t < lastTask; t = next++) {
+					const EnumerationTask &task = tasks[t];
+					std::fill(record.begin(), record.end(), 0);
+					for (uint32_t level = N; level > task.level; level--) {
+						const uint32_t var = flat.getVariableAtLevel(level);
+						layout.set(record.data(), var, task.values[var]);
+					}
+					enumerate(flat, layout, levelOf, task.level, task.node,
+							record.data(), buffers[t - firstTask]);
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> guard(errorLock);
+				if (!error)
+					error = std::current_exception();
+				next = lastTask;
+			}
+		};
+		vector<std::thread> pool;
+		for (unsigned int t = 1; t < threads && t < lastTask - firstTask; t++)
+			pool.push_back(std::thread(worker));
+		worker();
+		for (std::thread &t : pool)
+			t.join();
+		if (error)
+			std::rethrow_exception(error);
+		for (const vector<uint8_t> &buffer : buffers) {
+			output.write((const char*) buffer.data(), buffer.size());
+			h.count += layout.size > 0 ? buffer.size() / layout.size : 0;
+		}
+	}
+	// Models whose records are empty (a single product) still count it
+	if (layout.size == 0)
+		h.count = ranker.getCount().get_ui();
+	output.seekp(0);
+	output.write((const char*) &h, sizeof(h));
+	if (!output.good())
+		throw std::runtime_error("Error writing products file " + fileName);
+	return h.count;
+}
+
+/**
+ * Translates a binary file of products into a CSV file: one line per product, with
+ * either the value of each variable (with a header of the variable names) or the
+ * names of the selected features
+ *
+ * @param flat the MDD the products were enumerated from
+ * @param binaryFileName the file written by writeBinary
+ * @param csvFileName the name of the CSV file
+ * @param featureNames whether to write the selected features instead of the values
+ * @return the number of products
+ */
+uint64_t FlatEnumerator::decodeCsv(const FlatMdd &flat,
+		const string &binaryFileName, const string &csvFileName,
+		bool featureNames) {
+	ifstream input(binaryFileName, ios::in | ios::binary);
+	if (!input.is_open())
+		throw std::invalid_argument("Cannot open products file " + binaryFileName);
+	const uint32_t N = flat.getNumVariables();
+	const RecordLayout layout(flat);
+	ProductsHeader h;
+	input.read((char*) &h, sizeof(h));
+	bool valid = input.good() && memcmp(h.magic, PRODUCTS_MAGIC,
+			sizeof(PRODUCTS_MAGIC)) == 0 && h.version == PRODUCTS_VERSION
+			&& h.nVariables == N && h.recordSize == layout.size;
+	for (uint32_t var = 1; valid && var <= N; var++) {
+		uint32_t bound = 0;
+		input.read((char*) &bound, sizeof(bound));
+		valid = input.good() && bound == flat.getBound(var);
+	}
+	if (!valid)
+		throw std::invalid_argument(
+				binaryFileName + " is not a products file of this model");
+	ofstream output(csvFileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open CSV file " + csvFileName);
+
+	string text;
+	if (!featureNames) {
+		for (uint32_t var = 1; var <= N; var++)
+			text += string(flat.getVariableName(var)) + (var < N ? ";" : "");
+		text += "\n";
+	}
+	vector<uint8_t> record(layout.size);
+	vector<uint32_t> values(N + 1, 0);
+	for (uint64_t p = 0; p < h.count; p++) {
+		if (layout.size > 0
+				&& !input.read((char*) record.data(), layout.size))
+			throw std::invalid_argument("Truncated products file " + binaryFileName);
+		for (uint32_t var = 1; var <= N; var++)
+			values[var] = layout.get(record.data(), var);
+		if (featureNames) {
+			bool first = true;
+			for (uint32_t f : flat.decodeFeatures(values)) {
+				text += (first ? "" : ";");
+				text += flat.getFeatureName(f);
+				first = false;
+			}
+		} else
+			for (uint32_t var = 1; var <= N; var++)
+				text += to_string(values[var]) + (var < N ? ";" : "");
+		text += "\n";
+		if (text.size() >= DECODE_BUFFER) {
+			output << text;
+			text.clear();
+		}
+	}
+	output << text;
+	if (!output.good())
+		throw std::runtime_error("Error writing CSV file " + csvFileName);
+	return h.count;
+}
@@ -0,0 +1,251 @@
+/*
+ * FlatMarginals.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatMarginals.hpp"
+#include <fstream>
+#include <stdexcept>
+
+/**
+ * Computes the weights of the edges from a level to the levels of its children: the
+ * number of allowed assignments of the skipped levels
+ *
+ * @param prefix the prefix products of the number of allowed values
+ * @param used the levels of the children
+ * @param level the level of the parents
+ * @param weights (output) the weight for each used level
+ */
+static void computeWeights(const vector<mpz_class> &prefix,
+		const vector<char> &used, uint32_t level, vector<mpz_class> &weights) {
+	for (uint32_t lc = 0; lc < level; lc++)
+		if (used[lc])
+			weights[lc] = prefix[level - 1] / prefix[lc];
+}
+
+/**
+ * Computes, for each value of each variable, the number of products in which the
+ * variable takes that value
+ *
+ * @param flat the MDD
+ * @param threads the number of threads of the bottom-up pass (the top-down pass
+ * 		accumulates on shared nodes and is sequential)
+ * @param mask the allowed values (the products of a partial configuration)
+ * @param valueCounts (output) valueCounts[var][value], for var from 1 to N
+ * @return the number of products
+ */
+mpz_class FlatMarginals::countValues(const FlatMdd &flat, unsigned int threads,
+		const ValueMask &mask, vector<vector<mpz_class>> &valueCounts) {
+	const uint32_t N = flat.getNumVariables();
+	const uint32_t root = flat.getRoot();
+	valueCounts.assign(N + 1, vector<mpz_class>());
+	for (uint32_t var = 1; var <= N; var++)
+		valueCounts[var].assign(flat.getBound(var), 0);
+	vector<mpz_class> prefix;
+	if (!FlatCounter::computePrefixes(flat, mask, prefix) || root == FLAT_FALSE)
+		return 0;
+	vector<uint32_t> levelOf;
+	FlatCounter::computeNodeLevels(flat, levelOf);
+
+	// Assignments of the levels below each node reaching true
+	vector<mpz_class> below(flat.getNumNodes(), 0);
+	below[FLAT_TRUE] = 1;
+	vector<mpz_class> weights(N + 1);
+	vector<char> used(N + 1, false);
+	auto prepareLevel = [&](uint32_t level) {
+		FlatCounter::markChildLevels(flat, levelOf, level, used);
+		computeWeights(prefix, used, level, weights);
+	};
+	FlatCounter::forEachNodeByLevel(flat, threads, true, [&](uint32_t n) {
+		const uint32_t *children = flat.getChildren(n);
+		const char *allowed = FlatCounter::allowedValues(mask,
+				flat.getVariableAtLevel(levelOf[n]));
+		mpz_class &b = below[n];
+		for (uint32_t i = 0; i < flat.getNumChildren(n); i++)
+			if (children[i] != FLAT_FALSE && (allowed == NULL || allowed[i]))
+				mpz_addmul(b.get_mpz_t(), below[children[i]].get_mpz_t(),
+						weights[levelOf[children[i]]].get_mpz_t());
+	}, prepareLevel);
+
+	// Assignments of the levels above each node reaching it from the root. The root
+	// is reached from a virtual node above level N.
+	vector<mpz_class> above(flat.getNumNodes(), 0);
+	const uint32_t rootLevel = levelOf[root];
+	above[root] = prefix[N] / prefix[rootLevel];
+	const mpz_class total = above[root] * below[root];
+	// Products through the edges of each level, by value
+	vector<vector<mpz_class>> direct(N + 1);
+	for (uint32_t level = 1; level <= N; level++)
+		direct[level].assign(flat.getBound(flat.getVariableAtLevel(level)), 0);
+	// Differences of the products through edges skipping each level
+	vector<mpz_class> skipped(N + 2, 0);
+	skipped[rootLevel + 1] += total;
+	skipped[N + 1] -= total;
+	mpz_class through;
+	FlatCounter::forEachNodeByLevel(flat, 1, false, [&](uint32_t n) {
+		const uint32_t level = levelOf[n];
+		const uint32_t *children = flat.getChildren(n);
+		const char *allowed = FlatCounter::allowedValues(mask,
+				flat.getVariableAtLevel(level));
+		vector<mpz_class> &values = direct[level];
+		for (uint32_t i = 0; i < flat.getNumChildren(n); i++) {
+			const uint32_t c = children[i];
+			if (c == FLAT_FALSE || (allowed != NULL && !allowed[i]))
+				continue;
+			const uint32_t lc = levelOf[c];
+			mpz_class edge = above[n] * weights[lc];
+			through = edge * below[c];
+			values[i] += through;
+			if (lc + 1 < level) {
+				skipped[lc + 1] += through;
+				skipped[level] -= through;
+			}
+			if (c != FLAT_TRUE)
+				above[c] += edge;
+		}
+	}, prepareLevel);
+
+	// Products with each value: those through the edges of its level, plus an even
+	// share of those skipping the level
+	mpz_class skipping = 0;
+	for (uint32_t level = 1; level <= N; level++) {
+		skipping += skipped[level];
+		const uint32_t var = flat.getVariableAtLevel(level);
+		const char *allowed = FlatCounter::allowedValues(mask, var);
+		const mpz_class share = skipping / (prefix[level] / prefix[level - 1]);
+		for (uint32_t value = 0; value < flat.getBound(var); value++) {
+			if (allowed != NULL && !allowed[value])
+				continue;
+			valueCounts[var][value] = share + direct[level][value];
+		}
+	}
+	return total;
+}
+
+/**
+ * Computes, for each feature, the number of products in which it is selected
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param mask the allowed values (the products of a partial configuration)
+ * @param selected (output) the count of each feature, indexed as in the flat MDD
+ * @return the number of products
+ */
+mpz_class FlatMarginals::countFeatures(const FlatMdd &flat,
+		unsigned int threads, const ValueMask &mask, vector<mpz_class> &selected) {
+	vector<vector<mpz_class>> valueCounts;
+	mpz_class total = countValues(flat, threads, mask, valueCounts);
+	selected.assign(flat.getNumFeatures(), 0);
+	for (uint32_t f = 0; f < flat.getNumFeatures(); f++) {
+		const uint32_t var = flat.getFeatureVariable(f);
+		const uint32_t *values = flat.getFeatureValues(f);
+		for (uint32_t i = 0; i < flat.getNumFeatureValues(f); i++)
+			selected[f] += valueCounts[var][values[i]];
+	}
+	return total;
+}
+
+/**
+ * The ratio between two counts, 0 if the total is 0
+ */
+double FlatMarginals::ratio(const mpz_class &part, const mpz_class &total) {
+	return (total == 0) ? 0 : mpq_class(part, total).get_d();
+}
+
+/**
+ * Classifies the features with a single marginal pass: a feature is core if it is
+ * selected in all products and dead if it is selected in none. An optional feature
+ * implies its parent, so it is false-optional if it is selected in as many products
+ * as its parent (as many as all products if the parent is the root). Core and dead
+ * features are not reported as false-optional. A feature whose parent is not in the
+ * snapshot, and is not the root, is never false-optional.
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param classes (output) the class of each feature, indexed as in the flat MDD
+ * @return the number of products
+ */
+mpz_class FlatMarginals::classifyFeatures(const FlatMdd &flat,
+		unsigned int threads, vector<FeatureClass> &classes) {
+	vector<mpz_class> selected;
+	mpz_class total = countFeatures(flat, threads, ValueMask(), selected);
+	classes.assign(flat.getNumFeatures(), FEATURE_VARIANT);
+	for (uint32_t f = 0; f < flat.getNumFeatures(); f++) {
+		const uint32_t parent = flat.getFeatureParent(f);
+		if (selected[f] == 0)
+			classes[f] = FEATURE_DEAD;
+		else if (selected[f] == total)
+			classes[f] = FEATURE_CORE;
+		else if (flat.isFeatureOptional(f)
+				&& ((parent != FLAT_NO_PARENT && selected[f] == selected[parent])
+						|| (parent == FLAT_NO_PARENT && flat.isFeatureParentRoot(f)
+								&& selected[f] == total)))
+			classes[f] = FEATURE_FALSE_OPTIONAL;
+	}
+	return total;
+}
+
+/**
+ * The name of a class of features, as written in the report
+ */
+const char* FlatMarginals::getClassName(FeatureClass c) {
+	switch (c) {
+	case FEATURE_CORE:
+		return "core";
+	case FEATURE_DEAD:
+		return "dead";
+	case FEATURE_FALSE_OPTIONAL:
+		return "falseOptional";
+	default:
+		return "variant";
+	}
+}
+
+/**
+ * Writes the core, dead and false-optional features (see classifyFeatures) as a CSV
+ * file with the columns feature and type
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param fileName the name of the CSV file
+ * @param classCounts (output) the number of features of each class
+ */
+void FlatMarginals::writeFeatureClasses(const FlatMdd &flat,
+		unsigned int threads, const string &fileName,
+		vector<uint32_t> &classCounts) {
+	ofstream output(fileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open feature report " + fileName);
+	vector<FeatureClass> classes;
+	classifyFeatures(flat, threads, classes);
+	classCounts.assign(FEATURE_FALSE_OPTIONAL + 1, 0);
+	output << "feature;type\n";
+	for (uint32_t f = 0; f < flat.getNumFeatures(); f++) {
+		classCounts[classes[f]]++;
+		if (classes[f] != FEATURE_VARIANT)
+			output << flat.getFeatureName(f) << ";" << getClassName(classes[f])
+					<< "\n";
+	}
+}
+
+/**
+ * Writes the marginal count of every feature as a CSV file with the columns feature,
+ * selected (the number of products with the feature) and ratio (over all products)
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param fileName the name of the CSV file
+ */
+void FlatMarginals::writeCsv(const FlatMdd &flat, unsigned int threads,
+		const string &fileName) {
+	ofstream output(fileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open marginals file " + fileName);
+	vector<mpz_class> selected;
+	mpz_class total = countFeatures(flat, threads, ValueMask(), selected);
+	output << "feature;selected;ratio\n";
+	for (uint32_t f = 0; f < flat.getNumFeatures(); f++)
+		output << flat.getFeatureName(f) << ";" << selected[f] << ";"
+				<< ratio(selected[f], total) << "\n";
+}
@@ -0,0 +1,472 @@
+/*
+ * FlatMdd.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatMdd.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_set>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FLAT_MAGIC "FMFLAT1"
+#define FLAT_VERSION 3
+
+FlatMdd::FlatMdd() :
+		data(NULL), size(0), mapped(false), header(NULL) {
+}
+
+FlatMdd::~FlatMdd() {
+	if (mapped)
+		munmap((void*) data, size);
+}
+
+/**
+ * Uses the given memory as the content of the snapshot, after checking the header
+ * and the content (see validate)
+ */
+void FlatMdd::attach(const char *data, size_t size) {
+	if (size < sizeof(Header) || memcmp(data, FLAT_MAGIC, sizeof(FLAT_MAGIC)) != 0)
+		throw std::invalid_argument("Not a flat MDD snapshot");
+	const Header *h = (const Header*) data;
+	if (h->version != FLAT_VERSION)
+		throw std::invalid_argument(
+				"Unsupported flat MDD version " + to_string(h->version)
+						+ " (expected " + to_string(FLAT_VERSION)
+						+ "), export it again");
+	this->data = data;
+	this->size = size;
+	this->header = h;
+	validate();
+	// Built once, so that lookups are safe from concurrent readers
+	for (uint32_t f = 0; f < getNumFeatures(); f++)
+		featureIndex[getFeatureName(f)] = f;
+	const char *strings = data + header->offsets[SECTION_STRINGS];
+	const uint32_t *others = section(SECTION_OTHER_FEATURES);
+	for (uint32_t f = 0; f < header->nOtherFeatures; f++)
+		otherFeatures.insert(strings + others[f]);
+}
+
+/**
+ * Throws an invalid_argument about a corrupted snapshot if the condition is false
+ */
+static void require(bool condition, const string &what) {
+	if (!condition)
+		throw std::invalid_argument("Corrupted flat MDD snapshot: " + what);
+}
+
+/**
+ * Checks that the snapshot is consistent, so that the traversals never read outside
+ * of it: every section fits in the file with the length given by the header, the
+ * levels and the variables are a permutation, the nodes of each level have one child
+ * per value of its variable and all of them are in lower levels, and every string,
+ * label and feature refers to existing entries.
+ */
+void FlatMdd::validate() const {
+	const uint64_t N = header->nVariables;
+	const uint64_t nodes = header->nNodes;
+	const uint64_t features = header->nFeatures;
+	const uint64_t lengths[SECTION_COUNT] = { N + 1, N + 1, N + 1, N + 2,
+			nodes + 1, header->nChildren, N + 1, N + 2, header->nLabels,
+			features, features, features + 1, header->nFeatureValues, features,
+			features, header->nOtherFeatures, header->stringsSize };
+	for (int s = 0; s < SECTION_COUNT; s++) {
+		const uint64_t unit = (s == SECTION_STRINGS) ? 1 : sizeof(uint32_t);
+		require(header->offsets[s] % unit == 0 && header->offsets[s] >= sizeof(Header)
+				&& header->offsets[s] <= size
+				&& lengths[s] <= (size - header->offsets[s]) / unit,
+				"section " + to_string(s) + " is truncated");
+	}
+	require(nodes >= 2 && header->root < nodes, "invalid root");
+
+	const uint32_t *levelVar = section(SECTION_LEVEL_VAR);
+	const uint32_t *varLevel = section(SECTION_VAR_LEVEL);
+	const uint32_t *bound = section(SECTION_VAR_BOUND);
+	for (uint32_t level = 1; level <= N; level++) {
+		const uint32_t var = levelVar[level];
+		require(var >= 1 && var <= N && varLevel[var] == level,
+				"invalid variable order");
+		require(bound[var] > 0, "variable " + to_string(var) + " has no values");
+	}
+
+	const uint32_t *levelStart = section(SECTION_LEVEL_START);
+	const uint32_t *childStart = section(SECTION_CHILD_START);
+	const uint32_t *children = section(SECTION_CHILDREN);
+	require(levelStart[1] == 2 && levelStart[N + 1] == nodes,
+			"invalid level bounds");
+	require(childStart[0] == 0 && childStart[1] == 0 && childStart[2] == 0
+			&& childStart[nodes] == header->nChildren, "invalid child bounds");
+	for (uint32_t level = 1; level <= N; level++) {
+		require(levelStart[level] <= levelStart[level + 1],
+				"invalid bounds of level " + to_string(level));
+		const uint32_t values = bound[levelVar[level]];
+		for (uint32_t n = levelStart[level]; n < levelStart[level + 1]; n++) {
+			require(childStart[n] <= childStart[n + 1]
+					&& childStart[n + 1] - childStart[n] == values,
+					"node " + to_string(n) + " does not match the bound of its level");
+			for (uint32_t c = childStart[n]; c < childStart[n + 1]; c++)
+				require(children[c] < levelStart[level],
+						"node " + to_string(n) + " has an invalid child");
+		}
+	}
+
+	const uint64_t stringsSize = header->stringsSize;
+	const char *strings = data + header->offsets[SECTION_STRINGS];
+	require(stringsSize == 0 || strings[stringsSize - 1] == '\0',
+			"unterminated strings");
+	const uint32_t *varName = section(SECTION_VAR_NAME);
+	const uint32_t *labelStart = section(SECTION_LABEL_START);
+	const uint32_t *labels = section(SECTION_LABELS);
+	for (uint32_t var = 1; var <= N; var++) {
+		require(varName[var] < stringsSize
+				&& labelStart[var] <= labelStart[var + 1]
+				&& labelStart[var + 1] - labelStart[var] == bound[var],
+				"invalid names of variable " + to_string(var));
+	}
+	require(labelStart[N + 1] == header->nLabels, "invalid labels");
+	for (uint64_t l = 0; l < header->nLabels; l++)
+		require(labels[l] < stringsSize, "invalid labels");
+
+	const uint32_t *featureName = section(SECTION_FEATURE_NAME);
+	const uint32_t *featureVar = section(SECTION_FEATURE_VAR);
+	const uint32_t *valueStart = section(SECTION_FEATURE_VALUE_START);
+	const uint32_t *featureValues = section(SECTION_FEATURE_VALUES);
+	const uint32_t *featureParent = section(SECTION_FEATURE_PARENT);
+	require(valueStart[0] == 0 && valueStart[features] == header->nFeatureValues,
+			"invalid feature values");
+	for (uint32_t f = 0; f < features; f++) {
+		const uint32_t var = featureVar[f];
+		require(featureName[f] < stringsSize && var >= 1 && var <= N
+				&& valueStart[f] <= valueStart[f + 1]
+				&& (featureParent[f] < features || featureParent[f] == FLAT_NO_PARENT),
+				"invalid feature " + to_string(f));
+		for (uint32_t i = valueStart[f]; i < valueStart[f + 1]; i++)
+			require(featureValues[i] < bound[var],
+					"invalid values of feature " + to_string(f));
+	}
+	const uint32_t *others = section(SECTION_OTHER_FEATURES);
+	for (uint32_t f = 0; f < header->nOtherFeatures; f++)
+		require(others[f] < stringsSize, "invalid features without variable");
+}
+
+/**
+ * Builds the snapshot of the MDD rooted in the given edge
+ *
+ * @param root the root of the MDD
+ * @param v the visitor that defined the variables of the MDD
+ * @return the snapshot (to be deleted by the caller)
+ */
+FlatMdd* FlatMdd::fromEdge(const dd_edge &root, FeatureVisitor &v) {
+	expert_forest *ef = (expert_forest*) root.getForest();
+	const uint32_t N = v.getNVar();
+
+	// Collect the nodes, grouped by level
+	vector<vector<node_handle>> byLevel(N + 1);
+	unordered_set<node_handle> visited;
+	vector<node_handle> toVisit;
+	toVisit.push_back(root.getNode());
+	while (!toVisit.empty()) {
+		node_handle n = toVisit.back();
+		toVisit.pop_back();
+		if (ef->isTerminalNode(n) || !visited.insert(n).second)
+			continue;
+		byLevel[ef->getNodeLevel(n)].push_back(n);
+		unpacked_node *un = unpacked_node::newFromNode(ef, n, true);
+		for (int i = 0; i < un->getSize(); i++)
+			toVisit.push_back(un->d(i));
+		unpacked_node::recycle(un);
+	}
+
+	unordered_map<node_handle, uint32_t> ids;
+	auto idOf = [&](node_handle n) -> uint32_t {
+		if (ef->isTerminalNode(n))
+			return n == 0 ? FLAT_FALSE : FLAT_TRUE;
+		return ids[n];
+	};
+	vector<uint32_t> levelVar(N + 1, 0), varLevel(N + 1, 0), varBound(N + 1, 0);
+	vector<uint32_t> levelStart(N + 2, 0);
+	vector<uint32_t> childStart, children;
+	uint32_t nextId = 2;
+	// The terminals have no children: childStart[0..2] are all 0
+	childStart.assign(3, 0);
+	for (uint32_t level = 1; level <= N; level++) {
+		levelVar[level] = ef->getVarByLevel(level);
+		varLevel[levelVar[level]] = level;
+		varBound[levelVar[level]] = v.getBoundForVar(levelVar[level] - 1);
+	}
+	levelStart[1] = 2;
+	for (uint32_t level = 1; level <= N; level++) {
+		for (node_handle n : byLevel[level]) {
+			ids[n] = nextId++;
+			unpacked_node *un = unpacked_node::newFromNode(ef, n, true);
+			for (int i = 0; i < un->getSize(); i++)
+				children.push_back(idOf(un->d(i)));
+			unpacked_node::recycle(un);
+			childStart.push_back(children.size());
+		}
+		levelStart[level + 1] = nextId;
+	}
+
+	// Names and labels
+	string strings;
+	auto addString = [&strings](const string &s) -> uint32_t {
+		uint32_t offset = strings.size();
+		strings += s;
+		strings += '\0';
+		return offset;
+	};
+	vector<uint32_t> varName(N + 1, 0), labelStart(N + 2, 0), labels;
+	varName[0] = addString("");
+	for (uint32_t var = 1; var <= N; var++) {
+		varName[var] = addString(v.getNameForVar(var - 1));
+		labelStart[var] = labels.size();
+		for (uint32_t value = 0; value < varBound[var]; value++)
+			labels.push_back(addString(v.getValueForVar(var - 1, value)));
+	}
+	labelStart[N + 1] = labels.size();
+	vector<uint32_t> featureName, featureVar, featureValueStart, featureValues;
+	vector<uint32_t> otherFeatureName;
+	vector<string> names;
+	for (const string &name : v.getFeatureNames()) {
+		pair<int, vector<int>> selecting = v.getSelectingValues(name);
+		if (selecting.first < 0) {
+			otherFeatureName.push_back(addString(name));
+			continue;
+		}
+		names.push_back(name);
+		featureName.push_back(addString(name));
+		featureVar.push_back(selecting.first + 1);
+		featureValueStart.push_back(featureValues.size());
+		featureValues.insert(featureValues.end(), selecting.second.begin(),
+				selecting.second.end());
+	}
+	featureValueStart.push_back(featureValues.size());
+	// Tree of the features, restricted to those in the snapshot
+	unordered_map<string, uint32_t> featureOf;
+	for (uint32_t f = 0; f < names.size(); f++)
+		featureOf[names[f]] = f;
+	vector<uint32_t> featureParent, featureFlags;
+	for (const string &name : names) {
+		const string parent = v.getFeatureParent(name);
+		unordered_map<string, uint32_t>::const_iterator it = featureOf.find(
+				parent);
+		featureParent.push_back(it != featureOf.end() ? it->second : FLAT_NO_PARENT);
+		uint32_t flags = v.isOptionalFeature(name) ? FLAT_FEATURE_OPTIONAL : 0;
+		if (!parent.empty() && v.getFeatureParent(parent).empty())
+			flags |= FLAT_FEATURE_PARENT_ROOT;
+		if (v.isAbstractFeature(name))
+			flags |= FLAT_FEATURE_ABSTRACT;
+		featureFlags.push_back(flags);
+	}
+
+	const vector<uint32_t> *sections[SECTION_COUNT - 1] = { &levelVar, &varLevel,
+			&varBound, &levelStart, &childStart, &children, &varName,
+			&labelStart, &labels, &featureName, &featureVar, &featureValueStart,
+			&featureValues, &featureParent, &featureFlags, &otherFeatureName };
+	return fromSections(idOf(root.getNode()), sections, strings);
+}
+
+/**
+ * Builds a snapshot from the content of its sections (see Section), which is checked
+ * as in open(). The lengths in the header follow from the sizes of the sections.
+ *
+ * @param root the id of the root
+ * @param sections the uint32_t sections, in the order of Section
+ * @param strings the content of SECTION_STRINGS
+ * @return the snapshot (to be deleted by the caller)
+ */
+FlatMdd* FlatMdd::fromSections(uint32_t root,
+		const vector<uint32_t> *const sections[SECTION_COUNT - 1],
+		const string &strings) {
+	Header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC));
+	h.version = FLAT_VERSION;
+	h.nVariables = sections[SECTION_LEVEL_VAR]->size() - 1;
+	h.nNodes = sections[SECTION_CHILD_START]->size() - 1;
+	h.root = root;
+	h.nFeatures = sections[SECTION_FEATURE_NAME]->size();
+	h.nOtherFeatures = sections[SECTION_OTHER_FEATURES]->size();
+	h.nChildren = sections[SECTION_CHILDREN]->size();
+	h.nLabels = sections[SECTION_LABELS]->size();
+	h.nFeatureValues = sections[SECTION_FEATURE_VALUES]->size();
+	h.stringsSize = strings.size();
+	uint64_t offset = sizeof(Header);
+	for (int s = 0; s < SECTION_COUNT; s++) {
+		offset = (offset + 7) & ~((uint64_t) 7);
+		h.offsets[s] = offset;
+		offset += (s == SECTION_STRINGS) ?
+				strings.size() : sections[s]->size() * sizeof(uint32_t);
+	}
+
+	FlatMdd *flat = new FlatMdd();
+	flat->buffer.assign(offset, 0);
+	char *out = flat->buffer.data();
+	memcpy(out, &h, sizeof(h));
+	for (int s = 0; s < SECTION_COUNT - 1; s++)
+		if (!sections[s]->empty())
+			memcpy(out + h.offsets[s], sections[s]->data(),
+					sections[s]->size() * sizeof(uint32_t));
+	memcpy(out + h.offsets[SECTION_STRINGS], strings.data(), strings.size());
+	try {
+		flat->attach(out, offset);
+	} catch (...) {
+		delete flat;
+		throw;
+	}
+	return flat;
+}
+
+/**
+ * Maps a snapshot file in memory (read-only, shared)
+ *
+ * @param fileName the file written by write()
+ * @return the snapshot (to be deleted by the caller)
+ */
+FlatMdd* FlatMdd::open(const string &fileName) {
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::invalid_argument("Cannot open flat MDD " + fileName);
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		throw std::invalid_argument("Cannot read flat MDD " + fileName);
+	}
+	void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mem == MAP_FAILED)
+		throw std::invalid_argument("Cannot map flat MDD " + fileName);
+	FlatMdd *flat = new FlatMdd();
+	flat->mapped = true;
+	flat->data = (const char*) mem;
+	flat->size = st.st_size;
+	try {
+		flat->attach((const char*) mem, st.st_size);
+	} catch (std::invalid_argument &e) {
+		delete flat;
+		throw std::invalid_argument(fileName + ": " + e.what());
+	}
+	return flat;
+}
+
+/**
+ * Writes the snapshot to a file, to be opened with open()
+ *
+ * @param fileName the destination file
+ */
+void FlatMdd::write(const string &fileName) const {
+	ofstream out(fileName, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+		throw std::invalid_argument("Cannot open flat MDD " + fileName);
+	out.write(data, size);
+	if (!out.good())
+		throw std::runtime_error("Error writing flat MDD " + fileName);
+}
+
+/**
+ * The level of a node (0 for the terminals)
+ *
+ * @param node the id of the node
+ * @return the level of the node
+ */
+uint32_t FlatMdd::getLevel(uint32_t node) const {
+	const uint32_t *start = section(SECTION_LEVEL_START);
+	return std::upper_bound(start + 1, start + header->nVariables + 2, node)
+			- start - 1;
+}
+
+const char* FlatMdd::getVariableName(uint32_t variable) const {
+	return (const char*) (data + header->offsets[SECTION_STRINGS])
+			+ section(SECTION_VAR_NAME)[variable];
+}
+
+const char* FlatMdd::getValueLabel(uint32_t variable, uint32_t value) const {
+	return (const char*) (data + header->offsets[SECTION_STRINGS])
+			+ section(SECTION_LABELS)[section(SECTION_LABEL_START)[variable]
+					+ value];
+}
+
+const char* FlatMdd::getFeatureName(uint32_t feature) const {
+	return (const char*) (data + header->offsets[SECTION_STRINGS])
+			+ section(SECTION_FEATURE_NAME)[feature];
+}
+
+/**
+ * Looks for a feature by name
+ *
+ * @param name the name of the feature
+ * @return the index of the feature, or -1 if it is not in the snapshot
+ */
+int FlatMdd::findFeature(const string &name) const {
+	unordered_map<string, uint32_t>::const_iterator it = featureIndex.find(name);
+	return (it != featureIndex.end()) ? (int) it->second : -1;
+}
+
+/**
+ * Finds the values of the variables of a configuration: the value of each variable
+ * is the one selecting exactly the given features among those it encodes
+ *
+ * @param selected the names of the selected features (the others are deselected);
+ * 		the features without a variable are ignored
+ * @param values (output) the value of each variable, indexed from 1 to N
+ * @return false if some variable has no such value (the configuration cannot be
+ * 		encoded, so it is not a product)
+ */
+bool FlatMdd::encodeFeatures(const vector<string> &selected,
+		vector<uint32_t> &values) const {
+	vector<char> isSelected(getNumFeatures(), false);
+	for (const string &name : selected) {
+		int f = findFeature(name);
+		if (f < 0 && isFeatureWithoutVariable(name))
+			continue;
+		if (f < 0)
+			throw std::invalid_argument("Unknown feature: " + name);
+		isSelected[f] = true;
+	}
+	// Values still consistent with the features seen so far
+	vector<vector<char>> candidates(getNumVariables() + 1);
+	for (uint32_t var = 1; var <= getNumVariables(); var++)
+		candidates[var].assign(getBound(var), true);
+	vector<char> selecting;
+	for (uint32_t f = 0; f < getNumFeatures(); f++) {
+		vector<char> &candidate = candidates[getFeatureVariable(f)];
+		selecting.assign(candidate.size(), false);
+		for (uint32_t i = 0; i < getNumFeatureValues(f); i++)
+			selecting[getFeatureValues(f)[i]] = true;
+		for (uint32_t value = 0; value < candidate.size(); value++)
+			if (selecting[value] != isSelected[f])
+				candidate[value] = false;
+	}
+	values.assign(getNumVariables() + 1, 0);
+	for (uint32_t var = 1; var <= getNumVariables(); var++) {
+		vector<char>::const_iterator it = std::find(candidates[var].begin(),
+				candidates[var].end(), true);
+		if (it == candidates[var].end())
+			return false;
+		values[var] = it - candidates[var].begin();
+	}
+	return true;
+}
+
+/**
+ * The features selected by an assignment of the variables
+ *
+ * @param values the value of each variable, indexed from 1 to N
+ * @return the selected features, in the order of the snapshot
+ */
+vector<uint32_t> FlatMdd::decodeFeatures(const vector<uint32_t> &values) const {
+	vector<uint32_t> selected;
+	for (uint32_t f = 0; f < getNumFeatures(); f++) {
+		const uint32_t *v = getFeatureValues(f);
+		if (std::find(v, v + getNumFeatureValues(f), values[getFeatureVariable(f)])
+				!= v + getNumFeatureValues(f))
+			selected.push_back(f);
+	}
+	return selected;
+}
@@ -0,0 +1,136 @@
+/*
+ * FlatPairs.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatPairs.hpp"
+#include "FlatCounter.hpp"
+#include "FlatMarginals.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+
+/**
+ * Appends the reported pairs of literals of a feature with the following features
+ *
+ * @param flat the MDD
+ * @param a the feature
+ * @param selected the number of products with each feature
+ * @param total the number of products
+ * @param withA the number of products with a and each feature
+ * @param rareRatio the largest ratio of a rare pair
+ * @param out (output) the lines of the CSV file
+ * @return the number of pairs written
+ */
+static uint64_t writePairs(const FlatMdd &flat, uint32_t a,
+		const vector<mpz_class> &selected, const mpz_class &total,
+		const vector<mpz_class> &withA, double rareRatio, ostream &out) {
+	uint64_t written = 0;
+	const mpz_class countA[2] = { total - selected[a], selected[a] };
+	mpz_class pair;
+	for (uint32_t b = a + 1; b < flat.getNumFeatures(); b++) {
+		const mpz_class countB[2] = { total - selected[b], selected[b] };
+		for (int pa = 1; pa >= 0; pa--)
+			for (int pb = 1; pb >= 0; pb--) {
+				if (pa && pb)
+					pair = withA[b];
+				else if (pa)
+					pair = countA[1] - withA[b];
+				else if (pb)
+					pair = countB[1] - withA[b];
+				else
+					pair = total - countA[1] - countB[1] + withA[b];
+				const double ratio = FlatMarginals::ratio(pair, total);
+				if (pair != 0 && ratio > rareRatio)
+					continue;
+				out << (pa ? "" : "!") << flat.getFeatureName(a) << ";"
+						<< (pb ? "" : "!") << flat.getFeatureName(b) << ";" << pair
+						<< ";" << ratio << "\n";
+				written++;
+			}
+	}
+	return written;
+}
+
+/**
+ * Writes the pairs of feature literals that are infeasible (in no product) or rare
+ * (in at most the given ratio of the products) as a CSV file with the columns first,
+ * second, count and ratio. Literals are written as in --assume ("A" or "!A"). The
+ * literals in no product (dead features, and the negation of core features) make
+ * every one of their pairs infeasible, and those pairs are written too.
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param rareRatio the largest ratio of a rare pair (0 for the infeasible pairs only)
+ * @param fileName the name of the CSV file
+ * @return the number of pairs written
+ */
+uint64_t FlatPairs::writeCsv(const FlatMdd &flat, unsigned int threads,
+		double rareRatio, const string &fileName) {
+	ofstream output(fileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open pairs file " + fileName);
+	const uint32_t F = flat.getNumFeatures();
+	vector<mpz_class> selected;
+	const mpz_class total = FlatMarginals::countFeatures(flat, threads,
+			ValueMask(), selected);
+	output << "first;second;count;ratio\n";
+	if (total == 0)
+		return 0;
+
+	// The lines of each feature, written in order once all are computed
+	vector<string> lines(F);
+	vector<uint64_t> written(F, 0);
+	std::atomic<uint32_t> next(0);
+	std::exception_ptr error;
+	std::mutex errorLock;
+	std::atomic<bool> failed(false);
+	auto worker = [&]() {
+		try {
+			vector<mpz_class> withA;
+			ValueMask mask;
+			ostringstream out;
+			for (uint32_t a = next++; a < F && !failed; a = next++) {
+				// The pairs of core and dead features follow from the marginals
+				if (selected[a] == 0)
+					withA.assign(F, 0);
+				else if (selected[a] == total)
+					withA = selected;
+				else {
+					mask.clear();
+					FlatCounter::assume(flat, flat.getFeatureName(a), mask);
+					FlatMarginals::countFeatures(flat, 1, mask, withA);
+				}
+				out.str("");
+				written[a] = writePairs(flat, a, selected, total, withA, rareRatio,
+						out);
+				lines[a] = out.str();
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> guard(errorLock);
+			if (!error)
+				error = std::current_exception();
+			failed = true;
+		}
+	};
+	vector<std::thread> pool;
+	for (unsigned int t = 1; t < threads && t < F; t++)
+		pool.push_back(std::thread(worker));
+	worker();
+	for (std::thread &t : pool)
+		t.join();
+	if (error)
+		std::rethrow_exception(error);
+
+	uint64_t count = 0;
+	for (uint32_t a = 0; a < F; a++) {
+		output << lines[a];
+		count += written[a];
+	}
+	return count;
+}
@@ -0,0 +1,176 @@
+/*
+ * FlatRanker.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatRanker.hpp"
+#include "FlatCounter.hpp"
+#include <fstream>
+#include <stdexcept>
+
+/**
+ * Computes the number of completions of each node
+ *
+ * @param flat the MDD, which must outlive the ranker
+ * @param threads the number of threads
+ */
+FlatRanker::FlatRanker(const FlatMdd &flat, unsigned int threads) :
+		flat(flat) {
+	const uint32_t N = flat.getNumVariables();
+	FlatCounter::computePrefixes(flat, ValueMask(), prefix);
+	FlatCounter::computeNodeLevels(flat, levelOf);
+	counts.assign(flat.getNumNodes(), 0);
+	counts[FLAT_TRUE] = 1;
+	vector<mpz_class> weights(N + 1);
+	vector<char> used(N + 1, false);
+	FlatCounter::forEachNodeByLevel(flat, threads, true, [&](uint32_t n) {
+		const uint32_t *children = flat.getChildren(n);
+		mpz_class &c = counts[n];
+		for (uint32_t i = 0; i < flat.getNumChildren(n); i++)
+			if (children[i] != FLAT_FALSE)
+				mpz_addmul(c.get_mpz_t(), counts[children[i]].get_mpz_t(),
+						weights[levelOf[children[i]]].get_mpz_t());
+	}, [&](uint32_t level) {
+		FlatCounter::markChildLevels(flat, levelOf, level, used);
+		for (uint32_t lc = 0; lc < level; lc++)
+			if (used[lc])
+				mpz_divexact(weights[lc].get_mpz_t(),
+						prefix[level - 1].get_mpz_t(), prefix[lc].get_mpz_t());
+	});
+	total = 0;
+	completions(N, flat.getRoot(), total);
+}
+
+/**
+ * The number of completions of the levels 1..level through a node of that level or
+ * of a lower one
+ *
+ * @param level the level
+ * @param node the node
+ * @param result (output) the number of completions
+ */
+void FlatRanker::completions(uint32_t level, uint32_t node,
+		mpz_class &result) const {
+	if (node == FLAT_FALSE) {
+		result = 0;
+		return;
+	}
+	mpz_divexact(result.get_mpz_t(), prefix[level].get_mpz_t(),
+			prefix[levelOf[node]].get_mpz_t());
+	result *= counts[node];
+}
+
+/**
+ * The product of the given rank
+ *
+ * @param rank the rank, in [0, count)
+ * @param values (output) the value of each variable, indexed from 1 to N
+ */
+void FlatRanker::unrank(const mpz_class &rank, vector<uint32_t> &values) const {
+	if (rank < 0 || rank >= total)
+		throw std::out_of_range(
+				"Rank " + rank.get_str() + " is not in [0, " + total.get_str()
+						+ ")");
+	values.assign(flat.getNumVariables() + 1, 0);
+	mpz_class k = rank, sub, q;
+	uint32_t n = flat.getRoot();
+	for (uint32_t level = flat.getNumVariables(); level > 0; level--) {
+		const uint32_t var = flat.getVariableAtLevel(level);
+		if (level > levelOf[n]) {
+			// Every value leads to n
+			completions(level - 1, n, sub);
+			mpz_fdiv_qr(q.get_mpz_t(), k.get_mpz_t(), k.get_mpz_t(),
+					sub.get_mpz_t());
+			values[var] = q.get_ui();
+			continue;
+		}
+		const uint32_t *children = flat.getChildren(n);
+		uint32_t i = 0;
+		for (;; i++) {
+			completions(level - 1, children[i], sub);
+			if (k < sub)
+				break;
+			k -= sub;
+		}
+		values[var] = i;
+		n = children[i];
+	}
+}
+
+/**
+ * The rank of a product
+ *
+ * @param values the value of each variable, indexed from 1 to N
+ * @return the rank, or -1 if the values are not a product
+ */
+mpz_class FlatRanker::rank(const vector<uint32_t> &values) const {
+	mpz_class k = 0, sub;
+	uint32_t n = flat.getRoot();
+	for (uint32_t level = flat.getNumVariables(); level > 0 && n != FLAT_FALSE;
+			level--) {
+		const uint32_t var = flat.getVariableAtLevel(level);
+		if (values[var] >= flat.getBound(var))
+			return -1;
+		if (level > levelOf[n]) {
+			completions(level - 1, n, sub);
+			mpz_addmul_ui(k.get_mpz_t(), sub.get_mpz_t(), values[var]);
+			continue;
+		}
+		const uint32_t *children = flat.getChildren(n);
+		for (uint32_t i = 0; i < values[var]; i++) {
+			completions(level - 1, children[i], sub);
+			k += sub;
+		}
+		n = children[values[var]];
+	}
+	return (n == FLAT_FALSE) ? mpz_class(-1) : k;
+}
+
+/**
+ * Parses a rank written in decimal
+ *
+ * @param text the rank
+ * @return the rank
+ */
+mpz_class FlatRanker::parseRank(const string &text) {
+	mpz_class rank;
+	if (text.empty() || rank.set_str(text, 10) != 0 || rank < 0)
+		throw std::invalid_argument("Invalid rank: " + text);
+	return rank;
+}
+
+/**
+ * Writes the products of a range of ranks, in order, one per line with the names of
+ * their selected features separated by ';'
+ *
+ * @param flat the MDD
+ * @param threads the number of threads of the counting pass
+ * @param first the first rank
+ * @param last the rank after the last one (it is limited to the number of products)
+ * @param fileName the name of the output file
+ * @return the number of products written
+ */
+uint64_t FlatRanker::writeRange(const FlatMdd &flat, unsigned int threads,
+		const mpz_class &first, const mpz_class &last, const string &fileName) {
+	ofstream output(fileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open products file " + fileName);
+	FlatRanker ranker(flat, threads);
+	const mpz_class end = (last < ranker.getCount()) ? last : ranker.getCount();
+	vector<uint32_t> values;
+	uint64_t written = 0;
+	for (mpz_class k = first; k < end; ++k) {
+		ranker.unrank(k, values);
+		bool firstFeature = true;
+		for (uint32_t f : flat.decodeFeatures(values)) {
+			output << (firstFeature ? "" : ";") << flat.getFeatureName(f);
+			firstFeature = false;
+		}
+		output << "\n";
+		written++;
+	}
+	if (!output.good())
+		throw std::runtime_error("Error writing products file " + fileName);
+	return written;
+}
@@ -0,0 +1,181 @@
+/*
+ * FlatReports.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatReports.hpp"
+#include "FlatCounter.hpp"
+#include "FlatMarginals.hpp"
+#include "FlatPairs.hpp"
+#include "FlatSizes.hpp"
+#include "FlatSampler.hpp"
+#include "FlatRanker.hpp"
+#include "FlatEnumerator.hpp"
+#include "FlatValidator.hpp"
+#include "logger.hpp"
+#include <fstream>
+
+unsigned int FlatReports::THREADS = 1;
+string FlatReports::MARGINALS_FILE = "";
+string FlatReports::FEATURE_CLASSES_FILE = "";
+string FlatReports::PAIRS_FILE = "";
+double FlatReports::PAIRS_RARE_RATIO = 0;
+string FlatReports::SIZES_FILE = "";
+long FlatReports::MIN_SIZE = -1;
+long FlatReports::MAX_SIZE = -1;
+string FlatReports::SAMPLES_FILE = "";
+uint64_t FlatReports::SAMPLE_COUNT = 1000;
+uint64_t FlatReports::SAMPLE_SEED = 0;
+vector<vector<string>> FlatReports::RANK_QUERIES;
+vector<string> FlatReports::UNRANK_QUERIES;
+string FlatReports::RANGE_FILE = "";
+string FlatReports::RANGE_FIRST = "0";
+string FlatReports::RANGE_LAST = "";
+string FlatReports::PRODUCTS_FILE = "";
+string FlatReports::PRODUCTS_CSV_FILE = "";
+bool FlatReports::PRODUCT_NAMES = false;
+string FlatReports::VALIDATE_FILE = "";
+string FlatReports::VALIDATE_REPORT_FILE = "";
+
+/**
+ * Whether at least one analysis has been requested
+ */
+bool FlatReports::isRequested() {
+	return !MARGINALS_FILE.empty() || !FEATURE_CLASSES_FILE.empty()
+			|| !PAIRS_FILE.empty() || !SIZES_FILE.empty() || MIN_SIZE >= 0
+			|| MAX_SIZE >= 0 || !SAMPLES_FILE.empty() || !RANK_QUERIES.empty()
+			|| !UNRANK_QUERIES.empty() || !RANGE_FILE.empty()
+			|| !PRODUCTS_FILE.empty() || !VALIDATE_FILE.empty();
+}
+
+/**
+ * Checks that the files of the requested analyses can be opened, so that a wrong path
+ * is reported before a build rather than after it
+ */
+void FlatReports::checkFiles() {
+	for (const string &fileName : { MARGINALS_FILE, FEATURE_CLASSES_FILE,
+			PAIRS_FILE, SIZES_FILE, SAMPLES_FILE, RANGE_FILE, PRODUCTS_FILE,
+			PRODUCTS_CSV_FILE, VALIDATE_REPORT_FILE }) {
+		if (fileName.empty())
+			continue;
+		ofstream output(fileName, ios::app);
+		if (!output.is_open())
+			throw std::invalid_argument("Cannot open output file " + fileName);
+	}
+	if (!VALIDATE_FILE.empty()) {
+		ifstream input(VALIDATE_FILE);
+		if (!input.is_open())
+			throw std::invalid_argument(
+					"Cannot open configurations file " + VALIDATE_FILE);
+	}
+}
+
+/**
+ * Writes the requested analyses of the MDD
+ *
+ * @param flat the final MDD
+ */
+void FlatReports::write(const FlatMdd &flat) {
+	if (!MARGINALS_FILE.empty()) {
+		FlatMarginals::writeCsv(flat, THREADS, MARGINALS_FILE);
+		LOGCOUT(LOG_INFO) << "Feature marginals written to " << MARGINALS_FILE
+				<< endl;
+	}
+	if (!FEATURE_CLASSES_FILE.empty()) {
+		vector<uint32_t> counts;
+		FlatMarginals::writeFeatureClasses(flat, THREADS, FEATURE_CLASSES_FILE,
+				counts);
+		LOGCOUT(LOG_INFO) << "Core features: "
+				<< counts[FlatMarginals::FEATURE_CORE] << ", dead features: "
+				<< counts[FlatMarginals::FEATURE_DEAD]
+				<< ", false-optional features: "
+				<< counts[FlatMarginals::FEATURE_FALSE_OPTIONAL] << endl;
+		LOGCOUT(LOG_INFO) << "Feature report written to "
+				<< FEATURE_CLASSES_FILE << endl;
+	}
+	if (!PAIRS_FILE.empty()) {
+		uint64_t pairs = FlatPairs::writeCsv(flat, THREADS, PAIRS_RARE_RATIO,
+				PAIRS_FILE);
+		LOGCOUT(LOG_INFO) << pairs << " infeasible or rare pairs written to "
+				<< PAIRS_FILE << endl;
+	}
+	if (!SIZES_FILE.empty()) {
+		FlatSizes::writeCsv(flat, THREADS, SIZES_FILE);
+		LOGCOUT(LOG_INFO) << "Size distribution written to " << SIZES_FILE
+				<< endl;
+	}
+	if (MIN_SIZE >= 0 || MAX_SIZE >= 0) {
+		SizePolynomial bySize;
+		FlatSizes::countBySize(flat, THREADS, ValueMask(), bySize);
+		const mpz_class inRange = FlatSizes::countInRange(bySize, MIN_SIZE,
+				MAX_SIZE);
+		// Line "min;max;count", a bound is empty if not given
+		cout << (MIN_SIZE >= 0 ? to_string(MIN_SIZE) : "") << ";"
+				<< (MAX_SIZE >= 0 ? to_string(MAX_SIZE) : "") << ";" << inRange
+				<< endl;
+		LOGCOUT(LOG_INFO) << "Products with "
+				<< (MIN_SIZE >= 0 ? "at least " + to_string(MIN_SIZE) : "")
+				<< (MIN_SIZE >= 0 && MAX_SIZE >= 0 ? " and " : "")
+				<< (MAX_SIZE >= 0 ? "at most " + to_string(MAX_SIZE) : "")
+				<< " features: " << inRange << endl;
+	}
+	if (!SAMPLES_FILE.empty()) {
+		uint64_t samples = FlatSampler::writeSamples(flat, THREADS, SAMPLE_COUNT,
+				SAMPLE_SEED, SAMPLES_FILE);
+		LOGCOUT(LOG_INFO) << samples << " random products written to "
+				<< SAMPLES_FILE << endl;
+	}
+	if (!RANK_QUERIES.empty() || !UNRANK_QUERIES.empty()) {
+		FlatRanker ranker(flat, THREADS);
+		vector<uint32_t> values;
+		// Lines "features;rank", -1 for configurations that are not products
+		for (const vector<string> &features : RANK_QUERIES) {
+			string joined;
+			for (const string &f : features)
+				joined += (joined.empty() ? "" : " ") + f;
+			cout << joined << ";"
+					<< (flat.encodeFeatures(features, values) ?
+							ranker.rank(values) : mpz_class(-1)) << endl;
+		}
+		// Lines "rank;features"
+		for (const string &text : UNRANK_QUERIES) {
+			ranker.unrank(FlatRanker::parseRank(text), values);
+			cout << text << ";";
+			bool first = true;
+			for (uint32_t f : flat.decodeFeatures(values)) {
+				cout << (first ? "" : " ") << flat.getFeatureName(f);
+				first = false;
+			}
+			cout << endl;
+		}
+	}
+	if (!RANGE_FILE.empty()) {
+		mpz_class first = FlatRanker::parseRank(RANGE_FIRST);
+		mpz_class last = RANGE_LAST.empty() ?
+				FlatCounter::domainSize(flat) : FlatRanker::parseRank(RANGE_LAST);
+		uint64_t products = FlatRanker::writeRange(flat, THREADS, first, last,
+				RANGE_FILE);
+		LOGCOUT(LOG_INFO) << products << " products from rank " << first
+				<< " written to " << RANGE_FILE << endl;
+	}
+	if (!PRODUCTS_FILE.empty()) {
+		uint64_t products = FlatEnumerator::writeBinary(flat, THREADS,
+				PRODUCTS_FILE);
+		LOGCOUT(LOG_INFO) << products << " products written to " << PRODUCTS_FILE
+				<< endl;
+		if (!PRODUCTS_CSV_FILE.empty()) {
+			FlatEnumerator::decodeCsv(flat, PRODUCTS_FILE, PRODUCTS_CSV_FILE,
+					PRODUCT_NAMES);
+			LOGCOUT(LOG_INFO) << "Products decoded to " << PRODUCTS_CSV_FILE
+					<< endl;
+		}
+	}
+	if (!VALIDATE_FILE.empty()) {
+		pair<uint64_t, uint64_t> outcome = FlatValidator::writeReport(flat,
+				THREADS, VALIDATE_FILE, VALIDATE_REPORT_FILE);
+		LOGCOUT(LOG_INFO) << "Valid configurations: " << outcome.first
+				<< ", invalid configurations: " << outcome.second
+				<< " (written to " << VALIDATE_REPORT_FILE << ")" << endl;
+	}
+}
@@ -0,0 +1,262 @@
+/*
+ * FlatSampler.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatSampler.hpp"
+#include "FlatCounter.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+// Number of samples drawn with the same generator
+#define SAMPLE_BLOCK 4096
+// Nodes whose cumulative counts fit in 64 bits
+#define NO_EXACT UINT64_MAX
+
+/**
+ * The greatest common divisor of the counts of the children of a node (0 if they are
+ * all 0): the counts of the children are only compared with each other
+ *
+ * @param flat the MDD
+ * @param counts the counts of the nodes (see FlatCounter::countNodes)
+ * @param n the node
+ */
+static mpz_class commonFactor(const FlatMdd &flat,
+		const vector<mpz_class> &counts, uint32_t n) {
+	const uint32_t *children = flat.getChildren(n);
+	mpz_class g = 0;
+	for (uint32_t i = 0; i < flat.getNumChildren(n); i++)
+		if (children[i] != FLAT_FALSE)
+			mpz_gcd(g.get_mpz_t(), g.get_mpz_t(), counts[children[i]].get_mpz_t());
+	return g;
+}
+
+/**
+ * Draws a uniform integer below a bound, by rejection, from the words of a generator
+ *
+ * @param random the generator
+ * @param bound the bound, which must be positive
+ * @param r (output) the integer
+ */
+static void drawBelow(std::mt19937_64 &random, const mpz_class &bound,
+		mpz_class &r) {
+	const size_t bits = mpz_sizeinbase(bound.get_mpz_t(), 2);
+	vector<uint64_t> words((bits + 63) / 64);
+	do {
+		for (uint64_t &w : words)
+			w = random();
+		if (bits % 64)
+			words.back() &= (((uint64_t) 1) << (bits % 64)) - 1;
+		mpz_import(r.get_mpz_t(), words.size(), -1, sizeof(uint64_t), 0, 0,
+				words.data());
+	} while (r >= bound);
+}
+
+/**
+ * Computes the cumulative counts of the edges of the MDD
+ *
+ * @param flat the MDD, which must outlive the sampler
+ * @param threads the number of threads
+ */
+FlatSampler::FlatSampler(const FlatMdd &flat, unsigned int threads) :
+		flat(flat) {
+	FlatCounter::computeNodeLevels(flat, levelOf);
+	vector<mpz_class> counts;
+	FlatCounter::countNodes(flat, threads, counts);
+	const uint32_t nodes = flat.getNumNodes();
+	cumulative.assign(
+			(flat.getChildren(nodes - 1) + flat.getNumChildren(nodes - 1))
+					- flat.getChildren(0), 0);
+	vector<uint8_t> exact(nodes, 0);
+	FlatCounter::forEachNodeByLevel(flat, threads, true, [&](uint32_t n) {
+		const uint32_t *children = flat.getChildren(n);
+		uint64_t *partials = cumulative.data() + (children - flat.getChildren(0));
+		const mpz_class g = commonFactor(flat, counts, n);
+		if (g == 0)
+			return;
+		mpz_class total = 0, q;
+		for (uint32_t i = 0; i < flat.getNumChildren(n); i++)
+			if (children[i] != FLAT_FALSE)
+				total += counts[children[i]];
+		mpz_divexact(total.get_mpz_t(), total.get_mpz_t(), g.get_mpz_t());
+		if (mpz_sizeinbase(total.get_mpz_t(), 2) > 64) {
+			exact[n] = 1;
+			return;
+		}
+		uint64_t partial = 0;
+		for (uint32_t i = 0; i < flat.getNumChildren(n); i++) {
+			if (children[i] != FLAT_FALSE) {
+				mpz_divexact(q.get_mpz_t(), counts[children[i]].get_mpz_t(),
+						g.get_mpz_t());
+				partial += q.get_ui();
+			}
+			partials[i] = partial;
+		}
+	});
+	// The few nodes above 64 bits keep their cumulative counts in GMP
+	exactFirst.assign(nodes, NO_EXACT);
+	for (uint32_t n = 0; n < nodes; n++) {
+		if (!exact[n])
+			continue;
+		const uint32_t *children = flat.getChildren(n);
+		const mpz_class g = commonFactor(flat, counts, n);
+		mpz_class partial = 0;
+		exactFirst[n] = exactCumulative.size();
+		for (uint32_t i = 0; i < flat.getNumChildren(n); i++) {
+			if (children[i] != FLAT_FALSE)
+				partial += counts[children[i]] / g;
+			exactCumulative.push_back(partial);
+		}
+	}
+
+	selectedBy.resize(flat.getNumVariables() + 1);
+	for (uint32_t var = 1; var <= flat.getNumVariables(); var++)
+		selectedBy[var].resize(flat.getBound(var));
+	for (uint32_t f = 0; f < flat.getNumFeatures(); f++) {
+		const uint32_t *values = flat.getFeatureValues(f);
+		for (uint32_t i = 0; i < flat.getNumFeatureValues(f); i++)
+			selectedBy[flat.getFeatureVariable(f)][values[i]].push_back(f);
+	}
+}
+
+/**
+ * Whether the MDD has no product
+ */
+bool FlatSampler::isEmpty() const {
+	return flat.getRoot() == FLAT_FALSE;
+}
+
+/**
+ * Draws a product (the MDD must not be empty)
+ *
+ * @param random the generator
+ * @param values (output) the value of each variable, indexed from 1 to N
+ */
+void FlatSampler::sample(std::mt19937_64 &random,
+		vector<uint32_t> &values) const {
+	const uint32_t N = flat.getNumVariables();
+	values.assign(N + 1, 0);
+	uint32_t n = flat.getRoot();
+	uint32_t level = N;
+	mpz_class exactDraw;
+	while (level > 0) {
+		// Skipped levels are free
+		for (; level > levelOf[n]; level--) {
+			const uint32_t var = flat.getVariableAtLevel(level);
+			values[var] = std::uniform_int_distribution<uint32_t>(0,
+					flat.getBound(var) - 1)(random);
+		}
+		if (level == 0)
+			break;
+		// The edge i is taken if the draw falls in [partials[i - 1], partials[i])
+		const uint32_t *children = flat.getChildren(n);
+		const uint32_t last = flat.getNumChildren(n) - 1;
+		uint32_t i;
+		if (exactFirst[n] == NO_EXACT) {
+			const uint64_t *partials = cumulative.data()
+					+ (children - flat.getChildren(0));
+			const uint64_t draw = std::uniform_int_distribution<uint64_t>(0,
+					partials[last] - 1)(random);
+			i = std::upper_bound(partials, partials + last, draw) - partials;
+		} else {
+			const mpz_class *partials = exactCumulative.data() + exactFirst[n];
+			drawBelow(random, partials[last], exactDraw);
+			i = std::upper_bound(partials, partials + last, exactDraw)
+					- partials;
+		}
+		values[flat.getVariableAtLevel(level)] = i;
+		n = children[i];
+		level--;
+	}
+}
+
+/**
+ * Writes the names of the features selected by a product, separated by ';', as a line
+ *
+ * @param values the value of each variable (see sample)
+ * @param out the output stream
+ */
+void FlatSampler::writeFeatures(const vector<uint32_t> &values,
+		ostream &out) const {
+	bool first = true;
+	for (uint32_t var = 1; var < values.size(); var++)
+		for (uint32_t f : selectedBy[var][values[var]]) {
+			out << (first ? "" : ";") << flat.getFeatureName(f);
+			first = false;
+		}
+	out << "\n";
+}
+
+/**
+ * Writes uniform random products, one per line (see writeFeatures)
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param samples the number of products
+ * @param seed the seed of the generators
+ * @param fileName the name of the output file
+ * @return the number of products written (0 if the MDD has no product)
+ */
+uint64_t FlatSampler::writeSamples(const FlatMdd &flat, unsigned int threads,
+		uint64_t samples, uint64_t seed, const string &fileName) {
+	ofstream output(fileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open samples file " + fileName);
+	FlatSampler sampler(flat, threads);
+	if (sampler.isEmpty())
+		return 0;
+
+	// The blocks are written in order, a round of them at a time
+	const uint64_t blocks = (samples + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+	const uint64_t round = 4 * (uint64_t) threads;
+	for (uint64_t firstBlock = 0; firstBlock < blocks; firstBlock += round) {
+		const uint64_t lastBlock = std::min(firstBlock + round, blocks);
+		vector<string> text(lastBlock - firstBlock);
+		std::atomic<uint64_t> next(firstBlock);
+		std::exception_ptr error;
+		std::mutex errorLock;
+		auto worker = [&]() {
+			try {
+				vector<uint32_t> values;
+				ostringstream out;
+				for (uint64_t b = next++; b < lastBlock; b = next++) {
+					std::seed_seq seeds { (uint32_t) seed, (uint32_t) (seed >> 32),
+							(uint32_t) b, (uint32_t) (b >> 32) };
+					std::mt19937_64 random(seeds);
+					out.str("");
+					const uint64_t end = std::min((b + 1) * SAMPLE_BLOCK, samples);
+					for (uint64_t s = b * SAMPLE_BLOCK; s < end; s++) {
+						sampler.sample(random, values);
+						sampler.writeFeatures(values, out);
+					}
+					text[b - firstBlock] = out.str();
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> guard(errorLock);
+				if (!error)
+					error = std::current_exception();
+				next = lastBlock;
+			}
+		};
+		vector<std::thread> pool;
+		for (unsigned int t = 1; t < threads && t < lastBlock - firstBlock; t++)
+			pool.push_back(std::thread(worker));
+		worker();
+		for (std::thread &t : pool)
+			t.join();
+		if (error)
+			std::rethrow_exception(error);
+		for (const string &t : text)
+			output << t;
+	}
+	if (!output.good())
+		throw std::runtime_error("Error writing samples file " + fileName);
+	return samples;
+}
@@ -0,0 +1,215 @@
+/*
+ * FlatSizes.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatSizes.hpp"
+#include <fstream>
+#include <stdexcept>
+
+/**
+ * Adds the product of two polynomials, shifted by the given degree
+ *
+ * @param acc (input/output) the polynomial the product is added to
+ * @param a the first polynomial
+ * @param b the second polynomial
+ * @param shift the degree the product is multiplied by
+ */
+static void addProduct(SizePolynomial &acc, const SizePolynomial &a,
+		const SizePolynomial &b, size_t shift) {
+	if (a.empty() || b.empty())
+		return;
+	if (acc.size() < a.size() + b.size() - 1 + shift)
+		acc.resize(a.size() + b.size() - 1 + shift, 0);
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i] == 0)
+			continue;
+		for (size_t j = 0; j < b.size(); j++)
+			mpz_addmul(acc[i + j + shift].get_mpz_t(), a[i].get_mpz_t(),
+					b[j].get_mpz_t());
+	}
+}
+
+/**
+ * The product of two polynomials
+ */
+static SizePolynomial multiply(const SizePolynomial &a, const SizePolynomial &b) {
+	SizePolynomial result;
+	addProduct(result, a, b, 0);
+	return result;
+}
+
+/**
+ * Counts the products by size
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param mask the allowed values (the products of a partial configuration)
+ * @param bySize (output) the number of products of each size, from 0 to the largest
+ * 		size of a product
+ * @return the number of products
+ */
+mpz_class FlatSizes::countBySize(const FlatMdd &flat, unsigned int threads,
+		const ValueMask &mask, SizePolynomial &bySize) {
+	const uint32_t N = flat.getNumVariables();
+	const uint32_t root = flat.getRoot();
+	bySize.clear();
+
+	// Number of concrete features selected by each value of each variable
+	vector<vector<uint32_t>> selecting(N + 1);
+	for (uint32_t var = 1; var <= N; var++)
+		selecting[var].assign(flat.getBound(var), 0);
+	for (uint32_t f = 0; f < flat.getNumFeatures(); f++) {
+		if (flat.isFeatureAbstract(f))
+			continue;
+		const uint32_t *values = flat.getFeatureValues(f);
+		for (uint32_t i = 0; i < flat.getNumFeatureValues(f); i++)
+			selecting[flat.getFeatureVariable(f)][values[i]]++;
+	}
+	// Polynomial of the variable of each level
+	vector<SizePolynomial> levelPoly(N + 1);
+	for (uint32_t level = 1; level <= N; level++) {
+		const uint32_t var = flat.getVariableAtLevel(level);
+		const char *allowed = FlatCounter::allowedValues(mask, var);
+		for (uint32_t value = 0; value < flat.getBound(var); value++) {
+			if (allowed != NULL && !allowed[value])
+				continue;
+			const uint32_t w = selecting[var][value];
+			if (levelPoly[level].size() <= w)
+				levelPoly[level].resize(w + 1, 0);
+			levelPoly[level][w]++;
+		}
+		if (levelPoly[level].empty())
+			return 0;
+	}
+	if (root == FLAT_FALSE)
+		return 0;
+	vector<uint32_t> levelOf;
+	FlatCounter::computeNodeLevels(flat, levelOf);
+
+	// Polynomial of each node, over the levels from 1 to its own
+	vector<SizePolynomial> poly(flat.getNumNodes());
+	poly[FLAT_TRUE].assign(1, 1);
+	// Last level with an edge to the nodes of each level
+	vector<uint32_t> lastUse(N + 1, 0);
+	for (uint32_t level = 1; level <= N; level++)
+		for (uint32_t n = flat.getLevelStart(level);
+				n < flat.getLevelStart(level + 1); n++) {
+			const uint32_t *children = flat.getChildren(n);
+			for (uint32_t i = 0; i < flat.getNumChildren(n); i++)
+				lastUse[levelOf[children[i]]] = level;
+		}
+	// Polynomials of the levels skipped by the edges to each level lc: the product of
+	// the levels from lc+1 to upTo[lc]-1. Polynomials have no division, so there are no
+	// prefix products as in FlatMarginals: each product is instead extended one level
+	// at a time as the parents go up, and released after its last use.
+	vector<SizePolynomial> skipped(N + 1);
+	vector<uint32_t> upTo(N + 1, 0);
+	vector<char> used(N + 1, false);
+	auto prepareLevel = [&](uint32_t level) {
+		FlatCounter::markChildLevels(flat, levelOf, level, used);
+		for (uint32_t lc = 0; lc < level; lc++) {
+			if (!used[lc]) {
+				if (upTo[lc] > 0 && lastUse[lc] < level) {
+					SizePolynomial().swap(skipped[lc]);
+					upTo[lc] = 0;
+				}
+				continue;
+			}
+			if (upTo[lc] == 0) {
+				skipped[lc].assign(1, 1);
+				upTo[lc] = lc + 1;
+			}
+			for (; upTo[lc] < level; upTo[lc]++)
+				skipped[lc] = multiply(skipped[lc], levelPoly[upTo[lc]]);
+		}
+	};
+	FlatCounter::forEachNodeByLevel(flat, threads, true, [&](uint32_t n) {
+		const uint32_t level = levelOf[n];
+		const uint32_t var = flat.getVariableAtLevel(level);
+		const uint32_t *children = flat.getChildren(n);
+		const char *allowed = FlatCounter::allowedValues(mask, var);
+		// The children of each level are added first, then multiplied by the
+		// polynomial of the skipped levels
+		static thread_local vector<pair<uint32_t, SizePolynomial>> groups;
+		groups.clear();
+		SizePolynomial &p = poly[n];
+		for (uint32_t i = 0; i < flat.getNumChildren(n); i++) {
+			const uint32_t c = children[i];
+			if (c == FLAT_FALSE || (allowed != NULL && !allowed[i]))
+				continue;
+			const uint32_t lc = levelOf[c];
+			const uint32_t w = selecting[var][i];
+			SizePolynomial *target = &p;
+			if (lc + 1 < level) {
+				size_t g = 0;
+				while (g < groups.size() && groups[g].first != lc)
+					g++;
+				if (g == groups.size())
+					groups.push_back(make_pair(lc, SizePolynomial()));
+				target = &groups[g].second;
+			}
+			const SizePolynomial &child = poly[c];
+			if (target->size() < child.size() + w)
+				target->resize(child.size() + w, 0);
+			for (size_t k = 0; k < child.size(); k++)
+				(*target)[k + w] += child[k];
+		}
+		for (const pair<uint32_t, SizePolynomial> &g : groups)
+			addProduct(p, g.second, skipped[g.first], 0);
+	}, prepareLevel);
+
+	// The levels above the root are free
+	SizePolynomial result = poly[root];
+	for (uint32_t level = levelOf[root] + 1; level <= N; level++)
+		result = multiply(result, levelPoly[level]);
+	while (!result.empty() && result.back() == 0)
+		result.pop_back();
+	bySize = result;
+	mpz_class total = 0;
+	for (const mpz_class &c : bySize)
+		total += c;
+	return total;
+}
+
+/**
+ * The number of products whose size is in the given range
+ *
+ * @param bySize the number of products of each size (see countBySize)
+ * @param minSize the smallest size (negative for no lower bound)
+ * @param maxSize the largest size (negative for no upper bound)
+ * @return the number of products
+ */
+mpz_class FlatSizes::countInRange(const SizePolynomial &bySize, long minSize,
+		long maxSize) {
+	mpz_class count = 0;
+	for (size_t k = (minSize > 0) ? minSize : 0; k < bySize.size(); k++) {
+		if (maxSize >= 0 && k > (size_t) maxSize)
+			break;
+		count += bySize[k];
+	}
+	return count;
+}
+
+/**
+ * Writes the number of products of each size as a CSV file with the columns
+ * encodedFeatures (the number of selected concrete features that have a variable in
+ * the MDD: mandatory features folded out of it are not counted) and products
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param fileName the name of the CSV file
+ */
+void FlatSizes::writeCsv(const FlatMdd &flat, unsigned int threads,
+		const string &fileName) {
+	ofstream output(fileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open size distribution file "
+				+ fileName);
+	SizePolynomial bySize;
+	countBySize(flat, threads, ValueMask(), bySize);
+	output << "encodedFeatures;products\n";
+	for (size_t k = 0; k < bySize.size(); k++)
+		output << k << ";" << bySize[k] << "\n";
+}
@@ -0,0 +1,372 @@
+/*
+ * FlatValidator.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatValidator.hpp"
+#include "FlatCounter.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+// Number of configurations walked together
+#define VALIDATE_LANES 8
+// Number of rows read at once, and taken at once by a thread
+#define VALIDATE_CHUNK (1 << 16)
+#define VALIDATE_BLOCK 1024
+// No value selects the features
+#define NO_VALUE 0xFFFFFFFFu
+// Flag of the features selected by several values, the other bits index the candidates
+#define SEVERAL_VALUES 0x80000000u
+
+/**
+ * Builds the tables of the encoding
+ *
+ * @param flat the MDD, which must outlive the validator
+ */
+FlatValidator::FlatValidator(const FlatMdd &flat) :
+		flat(flat) {
+	const uint32_t N = flat.getNumVariables();
+	FlatCounter::computeNodeLevels(flat, levelOf);
+	vector<vector<vector<uint32_t>>> selecting(N + 1);
+	for (uint32_t var = 1; var <= N; var++)
+		selecting[var].resize(flat.getBound(var));
+	for (uint32_t f = 0; f < flat.getNumFeatures(); f++) {
+		const uint32_t *values = flat.getFeatureValues(f);
+		for (uint32_t i = 0; i < flat.getNumFeatureValues(f); i++)
+			selecting[flat.getFeatureVariable(f)][values[i]].push_back(f);
+	}
+	// Values selecting the same features are all candidates
+	valueOf.resize(N + 1);
+	for (uint32_t var = 1; var <= N; var++) {
+		map<vector<uint32_t>, vector<uint32_t>> values;
+		for (uint32_t value = 0; value < flat.getBound(var); value++)
+			values[selecting[var][value]].push_back(value);
+		for (auto &entry : values) {
+			if (entry.second.size() == 1) {
+				valueOf[var][entry.first] = entry.second[0];
+			} else {
+				valueOf[var][entry.first] = SEVERAL_VALUES | candidates.size();
+				candidates.push_back(entry.second);
+			}
+		}
+	}
+	emptyValue.assign(N + 1, NO_VALUE);
+	for (uint32_t var = 1; var <= N; var++) {
+		map<vector<uint32_t>, uint32_t>::const_iterator it = valueOf[var].find(
+				vector<uint32_t>());
+		if (it != valueOf[var].end())
+			emptyValue[var] = it->second;
+	}
+	singleValue.assign(flat.getNumFeatures(), NO_VALUE);
+	for (uint32_t f = 0; f < flat.getNumFeatures(); f++) {
+		const map<vector<uint32_t>, uint32_t> &values =
+				valueOf[flat.getFeatureVariable(f)];
+		map<vector<uint32_t>, uint32_t>::const_iterator it = values.find(
+				vector<uint32_t>(1, f));
+		if (it != values.end())
+			singleValue[f] = it->second;
+	}
+}
+
+/**
+ * Validates a single configuration (see encode and evaluate)
+ *
+ * @param selected the names of the selected features
+ * @return the result of the validation
+ */
+FlatValidator::Result FlatValidator::validate(
+		const vector<string> &selected) const {
+	vector<uint32_t> values(flat.getNumVariables() + 1, 0);
+	Result result = encode(selected, values.data());
+	evaluate(values.data(), 1, &result);
+	return result;
+}
+
+/**
+ * Encodes a configuration
+ *
+ * @param selected the names of the selected features
+ * @param values (output) the value of each variable, from 1 to N (values[0] unused),
+ * 		possibly referring to several candidate values
+ * @return VALID if the configuration has been encoded, the reason otherwise
+ */
+FlatValidator::Result FlatValidator::encode(const vector<string> &selected,
+		uint32_t *values) const {
+	const uint32_t N = flat.getNumVariables();
+	// The selected features of the variables that have some. The buffers are shared
+	// by the validators used on the thread, so the entries of the previous call are
+	// cleared before the resize (its model may have more variables).
+	static thread_local vector<vector<uint32_t>> byVariable;
+	static thread_local vector<uint32_t> touched;
+	for (uint32_t var : touched)
+		byVariable[var].clear();
+	touched.clear();
+	byVariable.resize(N + 1);
+	for (const string &name : selected) {
+		const int f = flat.findFeature(name);
+		if (f < 0 && flat.isFeatureWithoutVariable(name))
+			continue;
+		if (f < 0)
+			return { UNKNOWN_FEATURE, 0, name };
+		vector<uint32_t> &features = byVariable[flat.getFeatureVariable(f)];
+		if (features.empty())
+			touched.push_back(flat.getFeatureVariable(f));
+		features.push_back(f);
+	}
+	for (uint32_t var = 1; var <= N; var++)
+		values[var] = emptyValue[var];
+	for (uint32_t var : touched) {
+		vector<uint32_t> &features = byVariable[var];
+		std::sort(features.begin(), features.end());
+		features.erase(std::unique(features.begin(), features.end()),
+				features.end());
+		if (features.size() == 1)
+			values[var] = singleValue[features[0]];
+		else {
+			map<vector<uint32_t>, uint32_t>::const_iterator it =
+					valueOf[var].find(features);
+			values[var] = (it != valueOf[var].end()) ? it->second : NO_VALUE;
+		}
+	}
+	// The lowest level without a value is reported
+	for (uint32_t level = 1; level <= N; level++)
+		if (values[flat.getVariableAtLevel(level)] == NO_VALUE)
+			return { INCONSISTENT, level, "" };
+	return { VALID, 0, "" };
+}
+
+/**
+ * Looks for a path to the terminal true from a node, trying all the candidates of the
+ * variables with several values selecting the same features
+ *
+ * @param node an internal node
+ * @param values the values of the configuration (see encode)
+ * @param failed the nodes from which no path exists, with the lowest level reached
+ * @param level (input/output) lowered to the lowest level reached, if no path exists
+ * @return true if a path exists
+ */
+bool FlatValidator::search(uint32_t node, const uint32_t *values,
+		unordered_map<uint32_t, uint32_t> &failed, uint32_t &level) const {
+	const uint32_t nodeLevel = levelOf[node];
+	const uint32_t &value = values[flat.getVariableAtLevel(nodeLevel)];
+	const uint32_t *first = &value, *last = &value + 1;
+	if (value & SEVERAL_VALUES) {
+		const vector<uint32_t> &list = candidates[value & ~SEVERAL_VALUES];
+		first = list.data();
+		last = first + list.size();
+	}
+	const uint32_t *children = flat.getChildren(node);
+	uint32_t lowest = nodeLevel;
+	for (const uint32_t *v = first; v != last; v++) {
+		const uint32_t child = children[*v];
+		if (child == FLAT_TRUE)
+			return true;
+		if (child == FLAT_FALSE)
+			continue;
+		unordered_map<uint32_t, uint32_t>::const_iterator it = failed.find(child);
+		if (it != failed.end())
+			lowest = std::min(lowest, it->second);
+		else if (search(child, values, failed, lowest))
+			return true;
+	}
+	failed[node] = lowest;
+	level = std::min(level, lowest);
+	return false;
+}
+
+/**
+ * Walks the paths of encoded configurations, VALIDATE_LANES at a time
+ *
+ * @param values the values of the configurations, N + 1 for each one (see encode)
+ * @param count the number of configurations
+ * @param results (input/output) the results of encode: the configurations that could
+ * 		not be encoded are skipped, the others get VALID or EXCLUDED, with the violated
+ * 		level
+ */
+void FlatValidator::evaluate(const uint32_t *values, size_t count,
+		Result *results) const {
+	const uint32_t N = flat.getNumVariables();
+	unordered_map<uint32_t, uint32_t> failed;
+	for (size_t first = 0; first < count; first += VALIDATE_LANES) {
+		const size_t lanes = std::min((size_t) VALIDATE_LANES, count - first);
+		uint32_t node[VALIDATE_LANES], level[VALIDATE_LANES];
+		bool done[VALIDATE_LANES];
+		bool active = false;
+		for (size_t k = 0; k < lanes; k++) {
+			node[k] = flat.getRoot();
+			level[k] = 0;
+			done[k] = results[first + k].outcome != VALID || node[k] <= FLAT_TRUE;
+			active |= !done[k];
+		}
+		while (active) {
+			active = false;
+			for (size_t k = 0; k < lanes; k++) {
+				if (done[k])
+					continue;
+				level[k] = levelOf[node[k]];
+				const uint32_t *row = values + (first + k) * (N + 1);
+				const uint32_t value = row[flat.getVariableAtLevel(level[k])];
+				if (value & SEVERAL_VALUES) {
+					// The rest of the path is searched among the candidates
+					failed.clear();
+					node[k] = search(node[k], row, failed, level[k]) ?
+							FLAT_TRUE : FLAT_FALSE;
+					done[k] = true;
+					continue;
+				}
+				node[k] = flat.getChildren(node[k])[value];
+				done[k] = node[k] <= FLAT_TRUE;
+				active |= !done[k];
+			}
+		}
+		for (size_t k = 0; k < lanes; k++) {
+			if (results[first + k].outcome != VALID)
+				continue;
+			results[first + k] =
+					(node[k] == FLAT_TRUE) ?
+							Result { VALID, 0, "" } :
+							Result { EXCLUDED, level[k], "" };
+		}
+	}
+}
+
+/**
+ * Splits a row of the input into feature names, separated by ';' or ','
+ */
+vector<string> FlatValidator::parseRow(const string &line) {
+	vector<string> names;
+	for (size_t start = 0; start <= line.size();) {
+		size_t end = line.find_first_of(";,", start);
+		if (end == string::npos)
+			end = line.size();
+		const string field = line.substr(start, end - start);
+		const size_t first = field.find_first_not_of(" \t\r");
+		if (first != string::npos)
+			names.push_back(
+					field.substr(first,
+							field.find_last_not_of(" \t\r") - first + 1));
+		start = end + 1;
+	}
+	return names;
+}
+
+/**
+ * Validates the configurations of a file, one per line with the names of the
+ * selected features (as written by --samples; lines starting with # are skipped), and
+ * writes the invalid ones as a CSV file with the columns row (the line number), level
+ * and variable (the first violated level and its variable) and reason (excluded,
+ * inconsistent or unknown feature)
+ *
+ * @param flat the MDD
+ * @param threads the number of threads
+ * @param inputFileName the configurations
+ * @param reportFileName the CSV file of the invalid configurations
+ * @return the number of valid and of invalid configurations
+ */
+pair<uint64_t, uint64_t> FlatValidator::writeReport(const FlatMdd &flat,
+		unsigned int threads, const string &inputFileName,
+		const string &reportFileName) {
+	ifstream input(inputFileName);
+	if (!input.is_open())
+		throw std::invalid_argument("Cannot open configurations " + inputFileName);
+	ofstream output(reportFileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open validation report "
+				+ reportFileName);
+	const uint32_t N = flat.getNumVariables();
+	FlatValidator validator(flat);
+	output << "row;level;variable;reason\n";
+	uint64_t valid = 0, invalid = 0, lineNumber = 0;
+
+	vector<string> lines;
+	vector<uint64_t> rows;
+	while (true) {
+		// A chunk of rows, parsed and validated in parallel
+		lines.clear();
+		rows.clear();
+		string line;
+		while (lines.size() < VALIDATE_CHUNK && getline(input, line)) {
+			lineNumber++;
+			if (!line.empty() && line[0] == '#')
+				continue;
+			lines.push_back(line);
+			rows.push_back(lineNumber);
+		}
+		if (lines.empty())
+			break;
+		const size_t blocks = (lines.size() + VALIDATE_BLOCK - 1) / VALIDATE_BLOCK;
+		vector<string> text(blocks);
+		vector<uint64_t> invalidInBlock(blocks, 0);
+		std::atomic<size_t> next(0);
+		std::exception_ptr error;
+		std::mutex errorLock;
+		auto worker = [&]() {
+			try {
+				vector<uint32_t> values;
+				vector<Result> results;
+				ostringstream out;
+				for (size_t b = next++; b < blocks; b = next++) {
+					const size_t first = b * VALIDATE_BLOCK;
+					const size_t count = std::min((size_t) VALIDATE_BLOCK,
+							lines.size() - first);
+					values.assign(count * (N + 1), 0);
+					results.resize(count);
+					for (size_t r = 0; r < count; r++)
+						results[r] = validator.encode(parseRow(lines[first + r]),
+								values.data() + r * (N + 1));
+					validator.evaluate(values.data(), count, results.data());
+					out.str("");
+					for (size_t r = 0; r < count; r++) {
+						const Result &result = results[r];
+						if (result.outcome == VALID)
+							continue;
+						invalidInBlock[b]++;
+						out << rows[first + r] << ";" << result.level << ";"
+								<< (result.level > 0 ?
+										flat.getVariableName(
+												flat.getVariableAtLevel(
+														result.level)) :
+										"") << ";";
+						if (result.outcome == EXCLUDED)
+							out << "excluded\n";
+						else if (result.outcome == INCONSISTENT)
+							out << "inconsistent\n";
+						else
+							out << "unknown feature " << result.feature << "\n";
+					}
+					text[b] = out.str();
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> guard(errorLock);
+				if (!error)
+					error = std::current_exception();
+				next = blocks;
+			}
+		};
+		vector<std::thread> pool;
+		for (unsigned int t = 1; t < threads && t < blocks; t++)
+			pool.push_back(std::thread(worker));
+		worker();
+		for (std::thread &t : pool)
+			t.join();
+		if (error)
+			std::rethrow_exception(error);
+		for (size_t b = 0; b < blocks; b++) {
+			output << text[b];
+			invalid += invalidInBlock[b];
+			valid += std::min((size_t) VALIDATE_BLOCK,
+					lines.size() - b * VALIDATE_BLOCK) - invalidInBlock[b];
+		}
+	}
+	if (!output.good())
+		throw std::runtime_error("Error writing validation report "
+				+ reportFileName);
+	return make_pair(valid, invalid);
+}
@@ -0,0 +1,177 @@
+/*
+ * Heartbeat.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "Heartbeat.hpp"
+#include "Metrics.hpp"
+#include "TraceEvents.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static std::atomic<bool> enabled(false);
+static std::atomic<unsigned long> constraintsApplied(0);
+static std::atomic<unsigned long> constraintsTotal(0);
+static std::atomic<unsigned long> currentNodes(0);
+static std::atomic<unsigned long> currentEdges(0);
+static std::atomic<long> peakNodes(0);
+// Wall time of the first applied cross-tree constraint, used for the estimate
+static std::atomic<double> ctcStart(-1);
+// Constraints already applied when ctcStart was taken (not zero when resuming a checkpoint)
+static std::atomic<unsigned long> ctcFirst(0);
+static double startTime = 0;
+static string phase = "";
+static std::mutex phaseLock;
+
+static std::thread beater;
+static std::mutex stopLock;
+static std::condition_variable stopSignal;
+static bool stopping = false;
+static std::ofstream statusFile;
+
+/**
+ * Starts the heartbeat thread
+ *
+ * @param interval the number of seconds between two status lines
+ * @param fileName the file to which the lines are appended (stderr if empty)
+ */
+void Heartbeat::start(double interval, const string &fileName) {
+	if (interval <= 0)
+		throw std::invalid_argument("The heartbeat interval must be positive");
+	stop();
+	if (!fileName.empty()) {
+		statusFile.open(fileName, ios::out | ios::app);
+		if (!statusFile.is_open())
+			throw std::invalid_argument("Cannot open status file " + fileName);
+	}
+	startTime = Metrics::wallTime();
+	stopping = false;
+	enabled = true;
+	beater = std::thread([interval] {
+		std::ostream &out = statusFile.is_open() ? statusFile : std::cerr;
+		std::unique_lock<std::mutex> guard(stopLock);
+		while (!stopSignal.wait_for(guard,
+				std::chrono::duration<double>(interval), [] {
+					return stopping;
+				})) {
+			out << statusLine() << std::endl;
+		}
+	});
+}
+
+/**
+ * Stops the heartbeat thread (if it is running) and closes the status file
+ */
+void Heartbeat::stop() {
+	if (!beater.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> guard(stopLock);
+		stopping = true;
+	}
+	stopSignal.notify_one();
+	beater.join();
+	enabled = false;
+	if (statusFile.is_open())
+		statusFile.close();
+}
+
+bool Heartbeat::isEnabled() {
+	return enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Sets the name of the current phase
+ *
+ * @param name the name of the phase
+ * @return the previous phase, to be restored when the new one ends
+ */
+string Heartbeat::setPhase(const string &name) {
+	std::lock_guard<std::mutex> guard(phaseLock);
+	string previous = phase;
+	phase = name;
+	return previous;
+}
+
+/**
+ * Starts the cross-tree phase: the remaining time is estimated from the constraints
+ * applied from now on
+ *
+ * @param first the number of constraints already applied (e.g., by a resumed checkpoint)
+ * @param total the number of constraints to be applied
+ */
+void Heartbeat::startConstraints(unsigned long first, unsigned long total) {
+	ctcStart = Metrics::wallTime();
+	ctcFirst = first;
+	setConstraints(first, total);
+}
+
+/**
+ * Sets the progress of the cross-tree phase
+ *
+ * @param applied the number of constraints already applied
+ * @param total the number of constraints to be applied
+ */
+void Heartbeat::setConstraints(unsigned long applied, unsigned long total) {
+	constraintsApplied = applied;
+	constraintsTotal = total;
+}
+
+/**
+ * Sets the size of the MDD being built
+ *
+ * @param nodes the number of nodes
+ * @param edges the number of edges
+ * @param peak the peak number of nodes of the forest
+ */
+void Heartbeat::setForest(unsigned long nodes, unsigned long edges, long peak) {
+	currentNodes = nodes;
+	currentEdges = edges;
+	peakNodes = peak;
+}
+
+/**
+ * Sets the size of the MDD from the given edge. Counting the nodes requires a visit of
+ * the MDD, so nothing is done when the heartbeat is not running.
+ *
+ * @param edge the root of the MDD being built
+ */
+void Heartbeat::update(const dd_edge &edge) {
+	if (!isEnabled())
+		return;
+	setForest(edge.getNodeCount(), edge.getEdgeCount(),
+			edge.getForest()->getPeakNumNodes());
+}
+
+/**
+ * Builds the status line written at each beat
+ *
+ * @return the status line, without the final newline
+ */
+string Heartbeat::statusLine() {
+	double now = Metrics::wallTime();
+	std::ostringstream line;
+	{
+		std::lock_guard<std::mutex> guard(phaseLock);
+		line << "[heartbeat] elapsed=" << (long) (now - startTime) << "s phase="
+				<< (phase.empty() ? "-" : phase);
+	}
+	unsigned long applied = constraintsApplied;
+	unsigned long total = constraintsTotal;
+	unsigned long first = ctcFirst;
+	line << " ctc=" << applied << "/" << total << " nodes=" << currentNodes
+			<< " edges=" << currentEdges << " peakNodes=" << peakNodes
+			<< " rssKb=" << TraceEvents::getCurrentRSS();
+	// Linear estimate: later constraints are usually slower, so it is a lower bound
+	if (applied > first && applied < total)
+		line << " ctcEta>="
+				<< (long) ((now - ctcStart) / (applied - first) * (total - applied))
+				<< "s";
+	return line.str();
+}
@@ -0,0 +1,99 @@
+/*
+ * LevelProfiler.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "LevelProfiler.hpp"
+#include <unordered_set>
+#include <stdexcept>
+
+ofstream LevelProfiler::output;
+int LevelProfiler::checkpoints = 0;
+int LevelProfiler::EVERY_K = 0;
+
+/**
+ * Enables the profiler, writing the rows to the given file
+ *
+ * @param fileName the name of the CSV file
+ */
+void LevelProfiler::open(const string &fileName) {
+	output.open(fileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open level profile file " + fileName);
+	output << "checkpoint;label;step;level;variable;feature;nodes\n";
+	checkpoints = 0;
+}
+
+void LevelProfiler::close() {
+	if (output.is_open())
+		output.close();
+}
+
+bool LevelProfiler::isEnabled() {
+	return output.is_open();
+}
+
+/**
+ * Whether a checkpoint is due after the given number of cross-tree constraints
+ *
+ * @param appliedConstraints the number of constraints applied so far
+ * @return true if the profiler is enabled and EVERY_K constraints have been applied
+ */
+bool LevelProfiler::isStep(int appliedConstraints) {
+	return isEnabled() && EVERY_K > 0 && appliedConstraints % EVERY_K == 0;
+}
+
+/**
+ * Counts the nodes of each level of the MDD rooted in the given edge. Terminal nodes
+ * are not counted.
+ *
+ * @param e the root edge
+ * @return a vector v where v[k] is the number of nodes at level k (v[0] is unused)
+ */
+vector<unsigned long> LevelProfiler::countNodesPerLevel(const dd_edge &e) {
+	expert_forest *ef = (expert_forest*) e.getForest();
+	vector<unsigned long> nodes(ef->getNumVariables() + 1, 0);
+	unordered_set<node_handle> visited;
+	vector<node_handle> toVisit;
+	toVisit.push_back(e.getNode());
+
+	while (!toVisit.empty()) {
+		node_handle n = toVisit.back();
+		toVisit.pop_back();
+		if (ef->isTerminalNode(n) || !visited.insert(n).second)
+			continue;
+		nodes[ef->getNodeLevel(n)]++;
+		unpacked_node *un = unpacked_node::newFromNode(ef, n, true);
+		for (int i = 0; i < un->getSize(); i++)
+			toVisit.push_back(un->d(i));
+		unpacked_node::recycle(un);
+	}
+	return nodes;
+}
+
+/**
+ * Writes the width of each level of the MDD at the current checkpoint
+ *
+ * @param label the name of the checkpoint (e.g., the phase just completed)
+ * @param step the number of cross-tree constraints applied so far
+ * @param e the root edge of the MDD
+ * @param v the FeatureVisitor, used for retrieving the name of the variables
+ */
+void LevelProfiler::checkpoint(const string &label, int step,
+		const dd_edge &e, const FeatureVisitor &v) {
+	if (!isEnabled())
+		return;
+	forest *mdd = e.getForest();
+	vector<unsigned long> nodes = countNodesPerLevel(e);
+	checkpoints++;
+	for (unsigned int level = nodes.size() - 1; level > 0; level--) {
+		// Variables are created bottom-up: variable k corresponds to the (k-1)-th
+		// index of the FeatureVisitor, but its level changes after a reordering
+		int variable = mdd->getVarByLevel(level);
+		output << checkpoints << ";" << label << ";" << step << ";" << level
+				<< ";" << variable << ";" << v.getNameForVar(variable - 1)
+				<< ";" << nodes[level] << "\n";
+	}
+	output.flush();
+}
@@ -0,0 +1,261 @@
+/*
+ * MddFile.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "MddFile.hpp"
+#include "Util.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+
+#define MDD_FILE_MAGIC "FMMDD"
+#define MDD_FILE_VERSION 2
+
+#define REF_FALSE 0
+#define REF_TRUE 1
+#define REF_FIRST_NODE 2
+
+// Flags of the features in the feature tree table
+#define MDD_FEATURE_OPTIONAL 1
+#define MDD_FEATURE_ABSTRACT 2
+
+static void writeInt(ostream &out, int32_t value) {
+	out.write((const char*) &value, sizeof(value));
+}
+
+static void writeString(ostream &out, const string &text) {
+	writeInt(out, text.size());
+	out.write(text.data(), text.size());
+}
+
+static void writeStrings(ostream &out, const vector<string> &texts) {
+	writeInt(out, texts.size());
+	for (const string &t : texts)
+		writeString(out, t);
+}
+
+static int32_t readInt(istream &in) {
+	int32_t value;
+	if (!in.read((char*) &value, sizeof(value)))
+		throw std::invalid_argument("Unexpected end of MDD file");
+	return value;
+}
+
+static string readString(istream &in) {
+	int32_t size = readInt(in);
+	if (size < 0)
+		throw std::invalid_argument("Invalid string in MDD file");
+	string text(size, ' ');
+	if (!in.read(&text[0], size))
+		throw std::invalid_argument("Unexpected end of MDD file");
+	return text;
+}
+
+static vector<string> readStrings(istream &in) {
+	int32_t count = readInt(in);
+	vector<string> texts;
+	for (int32_t i = 0; i < count; i++)
+		texts.push_back(readString(in));
+	return texts;
+}
+
+/**
+ * Saves a compiled model
+ *
+ * @param fileName the destination file
+ * @param root the root of the MDD of the products
+ * @param v the visitor that defined the variables of the MDD
+ */
+void MddFile::save(const string &fileName, const dd_edge &root,
+		FeatureVisitor &v) {
+	ofstream out(fileName, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+		throw std::invalid_argument("Cannot open MDD file " + fileName);
+	expert_forest *ef = (expert_forest*) root.getForest();
+	const int N = v.getNVar();
+
+	out.write(MDD_FILE_MAGIC, strlen(MDD_FILE_MAGIC));
+	writeInt(out, MDD_FILE_VERSION);
+	writeInt(out, N);
+	for (int i = 0; i < N; i++)
+		writeInt(out, v.getBoundForVar(i));
+	for (int level = 1; level <= N; level++)
+		writeInt(out, ef->getVarByLevel(level));
+
+	writeInt(out, v.variables.size());
+	for (map<string, vector<string>*>::const_iterator it = v.variables.begin();
+			it != v.variables.end(); ++it) {
+		writeString(out, it->first);
+		writeInt(out, v.variableIndex[it->first]);
+		writeStrings(out, *it->second);
+	}
+	writeInt(out, v.substitutions.size());
+	for (map<string, string>::const_iterator it = v.substitutions.begin();
+			it != v.substitutions.end(); ++it) {
+		writeString(out, it->first);
+		writeString(out, it->second);
+	}
+	writeInt(out, v.andLeafs.size());
+	for (map<string, pair<string, vector<string>>>::const_iterator it =
+			v.andLeafs.begin(); it != v.andLeafs.end(); ++it) {
+		writeString(out, it->first);
+		writeString(out, it->second.first);
+		writeStrings(out, it->second.second);
+	}
+	writeInt(out, v.featureTree.size());
+	for (map<string, pair<string, bool>>::const_iterator it =
+			v.featureTree.begin(); it != v.featureTree.end(); ++it) {
+		writeString(out, it->first);
+		writeString(out, it->second.first);
+		writeInt(out,
+				(it->second.second ? MDD_FEATURE_OPTIONAL : 0)
+						| (v.abstractFeatures.count(it->first) ?
+								MDD_FEATURE_ABSTRACT : 0));
+	}
+
+	// Number the nodes in post-order, so that children always come first
+	unordered_map<node_handle, int32_t> refs;
+	vector<node_handle> order;
+	vector<pair<node_handle, bool>> toVisit;
+	toVisit.push_back(make_pair(root.getNode(), false));
+	while (!toVisit.empty()) {
+		pair<node_handle, bool> n = toVisit.back();
+		toVisit.pop_back();
+		if (ef->isTerminalNode(n.first) || refs.count(n.first))
+			continue;
+		if (n.second) {
+			refs[n.first] = REF_FIRST_NODE + order.size();
+			order.push_back(n.first);
+			continue;
+		}
+		toVisit.push_back(make_pair(n.first, true));
+		unpacked_node *un = unpacked_node::newFromNode(ef, n.first, true);
+		for (int i = 0; i < un->getSize(); i++)
+			toVisit.push_back(make_pair(un->d(i), false));
+		unpacked_node::recycle(un);
+	}
+
+	writeInt(out, order.size());
+	for (node_handle n : order) {
+		unpacked_node *un = unpacked_node::newFromNode(ef, n, true);
+		writeInt(out, ef->getVarByLevel(ef->getNodeLevel(n)));
+		writeInt(out, un->getSize());
+		for (int i = 0; i < un->getSize(); i++) {
+			node_handle child = un->d(i);
+			if (ef->isTerminalNode(child))
+				writeInt(out, child == 0 ? REF_FALSE : REF_TRUE);
+			else
+				writeInt(out, refs[child]);
+		}
+		unpacked_node::recycle(un);
+	}
+	node_handle r = root.getNode();
+	writeInt(out,
+			ef->isTerminalNode(r) ? (r == 0 ? REF_FALSE : REF_TRUE) : refs[r]);
+	if (!out.good())
+		throw std::runtime_error("Error writing MDD file " + fileName);
+}
+
+/**
+ * Loads a compiled model in a new forest. MEDDLY must have been initialized.
+ *
+ * The nodes are rebuilt bottom-up with the usual operations on edges: a node of
+ * variable x with children c_0..c_k-1 is the union of (x = i) AND c_i.
+ *
+ * @param fileName the file written by save
+ * @param v (output) an empty visitor, filled with the tables of the model
+ * @return the root of the MDD of the products
+ */
+dd_edge MddFile::load(const string &fileName, FeatureVisitor &v) {
+	ifstream in(fileName, ios::in | ios::binary);
+	if (!in.is_open())
+		throw std::invalid_argument("Cannot open MDD file " + fileName);
+	char magic[sizeof(MDD_FILE_MAGIC)] = { };
+	in.read(magic, strlen(MDD_FILE_MAGIC));
+	if (strcmp(magic, MDD_FILE_MAGIC) != 0 || readInt(in) != MDD_FILE_VERSION)
+		throw std::invalid_argument(fileName + " is not a valid MDD file");
+
+	const int N = readInt(in);
+	vector<int> bounds(N);
+	for (int &b : bounds)
+		b = readInt(in);
+	vector<int> order(N + 1, 0);
+	for (int level = 1; level <= N; level++)
+		order[level] = readInt(in);
+
+	int32_t count = readInt(in);
+	for (int32_t i = 0; i < count; i++) {
+		string name = readString(in);
+		int32_t index = readInt(in);
+		v.variables[name] = new vector<string>(readStrings(in));
+		v.variableIndex[name] = index;
+		v.indexVariable[index] = name;
+	}
+	count = readInt(in);
+	for (int32_t i = 0; i < count; i++) {
+		string name = readString(in);
+		v.substitutions[name] = readString(in);
+	}
+	count = readInt(in);
+	for (int32_t i = 0; i < count; i++) {
+		string name = readString(in);
+		string parent = readString(in);
+		v.andLeafs[name] = make_pair(parent, readStrings(in));
+	}
+	count = readInt(in);
+	for (int32_t i = 0; i < count; i++) {
+		string name = readString(in);
+		string parent = readString(in);
+		int32_t flags = readInt(in);
+		v.featureTree[name] = make_pair(parent,
+				(flags & MDD_FEATURE_OPTIONAL) != 0);
+		if (flags & MDD_FEATURE_ABSTRACT)
+			v.abstractFeatures.insert(name);
+	}
+	if (v.getNVar() != N)
+		throw std::invalid_argument("Inconsistent variables in " + fileName);
+
+	forest *mdd = Util::createForest(bounds.data(), N);
+	mdd->reorderVariables(order.data());
+	dd_edge falseEdge(mdd), trueEdge(mdd);
+	mdd->createEdge(false, falseEdge);
+	mdd->createEdge(true, trueEdge);
+
+	count = readInt(in);
+	vector<dd_edge> nodes;
+	nodes.reserve(count);
+	auto resolve = [&](int32_t ref) -> const dd_edge& {
+		if (ref == REF_FALSE)
+			return falseEdge;
+		if (ref == REF_TRUE)
+			return trueEdge;
+		if (ref - REF_FIRST_NODE >= (int32_t) nodes.size() || ref < 0)
+			throw std::invalid_argument("Invalid node reference in " + fileName);
+		return nodes[ref - REF_FIRST_NODE];
+	};
+	for (int32_t k = 0; k < count; k++) {
+		int32_t variable = readInt(in);
+		int32_t size = readInt(in);
+		if (variable < 1 || variable > N || size != bounds[variable - 1])
+			throw std::invalid_argument("Invalid node in " + fileName);
+		dd_edge node = falseEdge;
+		vector<int> literal(N, -1);
+		for (int32_t i = 0; i < size; i++) {
+			int32_t child = readInt(in);
+			if (child == REF_FALSE)
+				continue;
+			literal[N - variable] = i;
+			if (child == REF_TRUE)
+				node += Util::getMDDFromTuple(literal, mdd) * trueEdge;
+			else
+				node += Util::getMDDFromTuple(literal, mdd) * resolve(child);
+		}
+		nodes.push_back(node);
+	}
+	dd_edge root = resolve(readInt(in));
+	return root;
+}
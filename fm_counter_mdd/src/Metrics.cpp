@@ -0,0 +1,323 @@
+/*
+ * Metrics.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "Metrics.hpp"
+#include "TraceEvents.hpp"
+#include "AllocTracker.hpp"
+#include "Heartbeat.hpp"
+#include <meddly_expert.h>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <time.h>
+#include <sys/resource.h>
+
+bool Metrics::ENABLED = true;
+vector<Metrics::Phase> Metrics::phases;
+map<string, string> Metrics::values;
+set<string> Metrics::numericValues;
+const vector<string> Metrics::CSV_PHASES = { PHASE_READ, PHASE_PARSE,
+		PHASE_VISIT, PHASE_FOREST, PHASE_MANDATORY, PHASE_MANDATORY_NON_LEAF,
+		PHASE_OR, PHASE_ALT, PHASE_IMPLICATIONS, PHASE_CTC_COMPILE,
+		PHASE_CTC_APPLY, PHASE_REORDER, PHASE_COUNT };
+
+// Keys of the values written as extra CSV columns, after the phases
+static const vector<string> CSV_VALUES = { "peakRSSKb", "forestPeakNodes",
+		"forestGarbageCollections", "ctPings", "ctHits", "ctHitRate", "status",
+		"phaseReached", "constraintsApplied" };
+
+Metrics::PhaseTimer::PhaseTimer(const string &name) {
+	this->name = name;
+	this->wallStart = Metrics::wallTime();
+	this->cpuStart = Metrics::cpuTime();
+	this->traceStart = TraceEvents::now();
+	if (PerfCounters::isEnabled())
+		PerfCounters::read(perfStart);
+	this->allocPrevious = AllocTracker::enterPhase(name);
+	if (Heartbeat::isEnabled())
+		this->heartbeatPrevious = Heartbeat::setPhase(name);
+}
+
+Metrics::PhaseTimer::~PhaseTimer() {
+	AllocTracker::leavePhase(allocPrevious);
+	if (Heartbeat::isEnabled())
+		Heartbeat::setPhase(heartbeatPrevious);
+	long long counters[PERF_NUM_COUNTERS];
+	if (PerfCounters::isEnabled()) {
+		PerfCounters::read(counters);
+		for (int i = 0; i < PERF_NUM_COUNTERS; i++)
+			counters[i] = (counters[i] < 0 || perfStart[i] < 0) ?
+					-1 : counters[i] - perfStart[i];
+	}
+	Metrics::addPhase(name, Metrics::wallTime() - wallStart,
+			Metrics::cpuTime() - cpuStart,
+			PerfCounters::isEnabled() ? counters : NULL);
+	// Phases are also spans of the trace, when it is enabled
+	TraceEvents::complete(name, "phase", traceStart,
+			TraceEvents::now() - traceStart, "");
+}
+
+/**
+ * Wall-clock time, in seconds, from an arbitrary starting point
+ *
+ * @return the wall-clock time in seconds
+ */
+double Metrics::wallTime() {
+	return std::chrono::duration<double>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * CPU time used by the process, in seconds
+ *
+ * @return the CPU time in seconds
+ */
+double Metrics::cpuTime() {
+	return (double) clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * Peak resident set size of the process, as reported by getrusage
+ *
+ * @return the peak RSS in kilobytes
+ */
+long Metrics::getPeakRSS() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+	return usage.ru_maxrss;
+}
+
+Metrics::Phase* Metrics::findPhase(const string &name) {
+	for (Phase &p : phases)
+		if (p.name == name)
+			return &p;
+	return NULL;
+}
+
+/**
+ * Adds the given times to the phase with the given name
+ *
+ * @param name the name of the phase
+ * @param wall the elapsed wall-clock time, in seconds
+ * @param cpu the elapsed CPU time, in seconds
+ * @param counters the increments of the hardware counters (NULL if they are not enabled)
+ */
+void Metrics::addPhase(const string &name, double wall, double cpu,
+		const long long *counters) {
+	if (!ENABLED)
+		return;
+	Phase *p = findPhase(name);
+	if (p == NULL) {
+		phases.push_back( { name, 0, 0, 0, { } });
+		p = &phases.back();
+		for (int i = 0; i < PERF_NUM_COUNTERS; i++)
+			p->counters[i] = (counters != NULL) ? 0 : -1;
+	}
+	p->wall += wall;
+	p->cpu += cpu;
+	p->calls++;
+	for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+		if (counters == NULL || counters[i] < 0)
+			p->counters[i] = -1;
+		else if (p->counters[i] >= 0)
+			p->counters[i] += counters[i];
+	}
+}
+
+/**
+ * Sets a textual value (e.g., a status or a number of products, which may not fit
+ * in a double). It is written as a JSON string.
+ */
+void Metrics::setValue(const string &key, const string &value) {
+	values[key] = value;
+	numericValues.erase(key);
+}
+
+/**
+ * Sets a numeric value. It is written as a JSON number.
+ */
+void Metrics::setValue(const string &key, double value) {
+	// Enough digits to keep node counts and sizes exact, which the default 6 would round
+	std::ostringstream s;
+	s.precision(15);
+	s << value;
+	values[key] = s.str();
+	numericValues.insert(key);
+}
+
+/**
+ * Gives access to the compute table shared by all the operations, which MEDDLY
+ * keeps as a protected member of operation
+ */
+struct ComputeTableAccess: public operation {
+	static const compute_table* get() {
+		return Monolithic_CT;
+	}
+};
+
+/**
+ * Reads the statistics of the forest and of the compute table, together with the
+ * peak RSS of the process. It must be called before the forest is destroyed.
+ *
+ * @param mdd the forest
+ */
+void Metrics::collectForestStats(forest *mdd) {
+	setValue("peakRSSKb", getPeakRSS());
+	setValue("forestPeakNodes", mdd->getPeakNumNodes());
+	setValue("forestCurrentNodes", mdd->getCurrentNumNodes());
+	setValue("forestPeakMemory", mdd->getPeakMemoryUsed());
+	setValue("forestGarbageCollections", mdd->getStats().garbage_collections);
+	setValue("forestReclaimedNodes", mdd->getStats().reclaimed_nodes);
+
+	// Without a monolithic compute table (one table per operation) the counters are unknown
+	const compute_table *ct = ComputeTableAccess::get();
+	double pings = (ct != NULL) ? ct->getStats().pings : -1;
+	double hits = (ct != NULL) ? ct->getStats().hits : -1;
+	setValue("ctPings", pings);
+	setValue("ctHits", hits);
+	setValue("ctHitRate", (pings > 0) ? hits / pings : -1);
+}
+
+/**
+ * Escapes quotes and backslashes of a string written in a JSON document
+ *
+ * @param text the string to be escaped
+ * @return the escaped string
+ */
+string Metrics::jsonEscape(const string &text) {
+	string escaped;
+	for (char ch : text) {
+		if (ch == '"' || ch == '\\')
+			escaped += '\\';
+		escaped += ch;
+	}
+	return escaped;
+}
+
+/**
+ * Writes a number as a JSON value: infinity and NaN have no JSON representation,
+ * so they are written as null
+ *
+ * @param out the output stream
+ * @param value the number
+ */
+static void writeJsonNumber(std::ostream &out, double value) {
+	if (std::isfinite(value))
+		out << value;
+	else
+		out << "null";
+}
+
+/**
+ * Writes the metrics as a JSON object. Values set as numbers are written as JSON
+ * numbers, all the other ones (including the number of products) as strings.
+ * The collected metrics are not modified.
+ *
+ * @param out the output stream
+ */
+void Metrics::writeJson(std::ostream &out) {
+	out << "{\n  \"phases\": [";
+	for (unsigned int i = 0; i < phases.size(); i++) {
+		out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << phases[i].name
+				<< "\", \"wall\": ";
+		writeJsonNumber(out, phases[i].wall);
+		out << ", \"cpu\": ";
+		writeJsonNumber(out, phases[i].cpu);
+		out << ", \"calls\": " << phases[i].calls;
+		if (PerfCounters::REQUESTED) {
+			for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+				out << ", \"" << PerfCounters::NAMES[c] << "\": "
+						<< phases[i].counters[c];
+			writePerfRatios(out, phases[i], true);
+		}
+		out << "}";
+	}
+	out << "\n  ]";
+	if (AllocTracker::isEnabled()) {
+		out << ",\n  \"allocations\": " << AllocTracker::getAllocations()
+				<< ",\n  \"allocatedBytes\": " << AllocTracker::getAllocatedBytes()
+				<< ",\n  \"peakLiveBytes\": " << AllocTracker::getPeakLiveBytes();
+		AllocTracker::writeJson(out);
+	}
+	for (map<string, string>::const_iterator it = values.begin();
+			it != values.end(); ++it) {
+		out << ",\n  \"" << it->first << "\": ";
+		if (numericValues.count(it->first))
+			writeJsonNumber(out, std::stod(it->second));
+		else
+			out << "\"" << jsonEscape(it->second) << "\"";
+	}
+	out << "\n}\n";
+}
+
+/**
+ * Writes the metrics as extra columns of the CSV result line (each column is
+ * preceded by ';'). The columns are the wall and CPU times of each phase, in
+ * the order of CSV_PHASES, then (only if hardware counters have been requested)
+ * IPC, LLC and dTLB misses per kilo-instruction of each phase, followed by the
+ * memory and forest statistics and by the status of the run (see Budget).
+ *
+ * @param out the output stream
+ */
+void Metrics::writeCsvColumns(std::ostream &out) {
+	for (const string &name : CSV_PHASES) {
+		Phase *p = findPhase(name);
+		out << ";" << (p ? p->wall : 0) << ";" << (p ? p->cpu : 0);
+	}
+	if (PerfCounters::REQUESTED)
+		writePerfCsvColumns(out);
+	for (const string &key : CSV_VALUES) {
+		out << ";" << (values.count(key) ? values[key] : "");
+	}
+}
+
+/**
+ * Writes, for each phase in the order of CSV_PHASES, the instructions per cycle and
+ * the LLC and dTLB misses per kilo-instruction as extra CSV columns (-1 if unavailable)
+ *
+ * @param out the output stream
+ */
+void Metrics::writePerfCsvColumns(std::ostream &out) {
+	for (const string &name : CSV_PHASES) {
+		Phase *p = findPhase(name);
+		if (p != NULL)
+			writePerfRatios(out, *p, false);
+		else
+			out << ";-1;-1;-1";
+	}
+}
+
+/**
+ * Writes the IPC and the LLC and dTLB misses per kilo-instruction of a phase
+ *
+ * @param out the output stream
+ * @param p the phase
+ * @param json whether the values are written as JSON fields or CSV columns
+ */
+void Metrics::writePerfRatios(std::ostream &out, const Phase &p, bool json) {
+	double ratios[3] = {
+			PerfCounters::ratio(p.counters[PERF_INSTRUCTIONS], p.counters[PERF_CYCLES], 1),
+			PerfCounters::ratio(p.counters[PERF_LLC_MISSES], p.counters[PERF_INSTRUCTIONS], 1000),
+			PerfCounters::ratio(p.counters[PERF_DTLB_MISSES], p.counters[PERF_INSTRUCTIONS], 1000) };
+	const char *names[3] = { "ipc", "llcMpki", "dtlbMpki" };
+	for (int i = 0; i < 3; i++) {
+		if (json) {
+			out << ", \"" << names[i] << "\": ";
+			writeJsonNumber(out, ratios[i]);
+		} else
+			out << ";" << ratios[i];
+	}
+}
+
+/**
+ * Clears all the collected metrics
+ */
+void Metrics::reset() {
+	phases.clear();
+	values.clear();
+	numericValues.clear();
+}
@@ -6,6 +6,9 @@
 #include <iostream>
 #include <string.h>
 #include <math.h>
+#include <set>
+#include "TraceEvents.hpp"
+#include "AllocTracker.hpp"
 
 using namespace std;
 using namespace rapidxml;
@@ -88,14 +91,19 @@ bool FeatureVisitor::isVisitable(xml_node<> *node) {
  * @param node the node to be visited
  */
 void FeatureVisitor::visit(xml_node<> *node) {
+	AllocTracker::Scope allocScope("visitor");
 	if (!isVisitable(node))
 		return;
 
-	logcout(LOG_DEBUG) << "Visiting node "
+	TraceEvents::Span span("visit", "visitor");
+	if (TraceEvents::isEnabled())
+		span.setArg("feature", node->first_attribute("name")->value());
+
+	LOGCOUT(LOG_DEBUG) << "Visiting node "
 			<< node->first_attribute("name")->value() << endl;
 
 	if (ignoreHidden && node->first_attribute("hidden")) {
-		logcout(LOG_DEBUG) << "\tIgnoring node "
+		LOGCOUT(LOG_DEBUG) << "\tIgnoring node "
 				<< node->first_attribute("name")->value() << " as it is hidden"
 				<< endl;
 		return;
@@ -802,10 +810,12 @@ void FeatureVisitor::setDependency(xml_node<> *node) {
  * @return the vector of mandatory indexes
  */
 vector<int> FeatureVisitor::getMandatoryIndex() {
+	AllocTracker::Scope allocScope("indexCopies");
 	return mandatoryIndex;
 }
 
 vector<pair<pair<int, int>, vector<int>*>> FeatureVisitor::getOrIndexs() {
+	AllocTracker::Scope allocScope("indexCopies");
 	return orIndexs;
 }
 
@@ -820,7 +830,7 @@ vector<pair<pair<int, int>, vector<int>*>> FeatureVisitor::getOrIndexs() {
 void FeatureVisitor::printDefinedVariables() {
 	for (map<string, vector<string>*>::const_iterator it = variables.begin();
 			it != variables.end(); ++it) {
-		logcout(LOG_DEBUG) << it->first << " - index: "
+		LOGCOUT(LOG_DEBUG) << it->first << " - index: "
 				<< variableIndex[it->first] << " - size: " << it->second->size()
 				<< endl;
 	}
@@ -836,14 +846,17 @@ int FeatureVisitor::getNVar() {
 }
 
 vector<pair<pair<int, int>, pair<int, int>> > FeatureVisitor::getMandatoryImplications() {
+	AllocTracker::Scope allocScope("indexCopies");
 	return mandatoryImplications;
 }
 
 vector<pair<pair<int, int>, pair<int, int>> > FeatureVisitor::getSingleImplications() {
+	AllocTracker::Scope allocScope("indexCopies");
 	return singleImplications;
 }
 
 vector<pair<pair<int, int>, pair<int, int>> > FeatureVisitor::getSingleImplicationsNonLeaf() {
+	AllocTracker::Scope allocScope("indexCopies");
 	return singleImplicationsNonLeaf;
 }
 
@@ -882,7 +895,166 @@ string FeatureVisitor::getValueForVar(int indexVar, int indexVal) {
 	return variables[indexVariable[indexVar]]->data()[indexVal];
 }
 
+/**
+ * Given the index of a variable, it returns its name (i.e., the name of the feature
+ * or group it has been created for)
+ *
+ * @param indexVar the index of the variable
+ * @return the name of the variable, or an empty string if the index is not defined
+ */
+string FeatureVisitor::getNameForVar(int indexVar) const {
+	map<int, string>::const_iterator it = indexVariable.find(indexVar);
+	return (it != indexVariable.end()) ? it->second : "";
+}
+
+/**
+ * Given the name of a feature, it returns the variable encoding it and the values of
+ * that variable for which the feature is selected. The lookup is the same used for the
+ * constraints: substitutions of mandatory leaves, boolean and enumerative variables,
+ * values of ALT variables and children merged into AND/OR variables.
+ *
+ * @param featureName the name of the feature
+ * @return a pair <x,v> where x is the index of the variable and v the selecting values,
+ * 		or <-1, {}> if the feature is not represented (e.g., it is hidden and ignored)
+ */
+pair<int, vector<int>> FeatureVisitor::getSelectingValues(
+		const string &featureName) {
+	string name = featureName;
+	if (substitutions.count(name))
+		name = substitutions[name];
+
+	vector<int> selecting;
+	if (variableIndex.count(name) > 0 && variables.count(name) > 0) {
+		// The feature has its own variable: it is selected by every value but none/false
+		int noneIndex = getIndexOfNoneForVariable(name);
+		for (int i = 0; i < (int) variables[name]->size(); i++)
+			if (i != noneIndex)
+				selecting.push_back(i);
+		return make_pair(variableIndex[name], selecting);
+	}
+
+	// The feature is a value of an ALT variable
+	pair<int, int> value = getIndexOfValue(name);
+	if (value.first != -1) {
+		selecting.push_back(value.second);
+		return make_pair(value.first, selecting);
+	}
+
+	// The feature has been merged into the variable of its AND/OR parent
+	if (andLeafs.count(name) > 0) {
+		vector<string> *parentValues = variables[andLeafs[name].first];
+		for (const string &v : andLeafs[name].second)
+			selecting.push_back(
+					std::find(parentValues->begin(), parentValues->end(), v)
+							- parentValues->begin());
+		return make_pair(variableIndex[andLeafs[name].first], selecting);
+	}
+
+	return make_pair(-1, selecting);
+}
+
+/**
+ * It records the parent of each feature of the tree rooted in the given node and
+ * whether the feature is optional, i.e., a child of an AND group that is not
+ * mandatory, and whether it is abstract. Unlike visit, it sees every feature, whatever
+ * its encoding.
+ *
+ * @param node the root of the tree
+ */
+void FeatureVisitor::readFeatureTree(xml_node<> *node) {
+	if (!isVisitable(node) || !node->first_attribute("name"))
+		return;
+	if (ignoreHidden && node->first_attribute("hidden"))
+		return;
+	xml_node<> *parent = node->parent();
+	string parentName = "";
+	bool optional = false;
+	if (parent != NULL && parent->first_attribute("name")) {
+		parentName = parent->first_attribute("name")->value();
+		optional = strcmp(parent->name(), "and") == 0
+				&& !(node->first_attribute("mandatory")
+						&& strcmp(node->first_attribute("mandatory")->value(),
+								"true") == 0);
+	}
+	featureTree[node->first_attribute("name")->value()] = make_pair(parentName,
+			optional);
+	if (node->first_attribute("abstract")
+			&& strcmp(node->first_attribute("abstract")->value(), "true") == 0)
+		abstractFeatures.insert(node->first_attribute("name")->value());
+	for (xml_node<> *n = node->first_node(); n; n = n->next_sibling())
+		readFeatureTree(n);
+}
+
+/**
+ * It returns the parent of a feature in the tree (see readFeatureTree)
+ *
+ * @param featureName the name of the feature
+ * @return the name of the parent, or an empty string for the root and for unknown
+ * 		features
+ */
+string FeatureVisitor::getFeatureParent(const string &featureName) const {
+	map<string, pair<string, bool>>::const_iterator it = featureTree.find(
+			featureName);
+	return (it != featureTree.end()) ? it->second.first : "";
+}
+
+/**
+ * It returns whether a feature is optional in the tree (see readFeatureTree)
+ *
+ * @param featureName the name of the feature
+ * @return true if the feature is a non-mandatory child of an AND group
+ */
+bool FeatureVisitor::isOptionalFeature(const string &featureName) const {
+	map<string, pair<string, bool>>::const_iterator it = featureTree.find(
+			featureName);
+	return it != featureTree.end() && it->second.second;
+}
+
+/**
+ * It returns whether a feature is abstract in the tree (see readFeatureTree)
+ *
+ * @param featureName the name of the feature
+ * @return true if the feature is abstract
+ */
+bool FeatureVisitor::isAbstractFeature(const string &featureName) const {
+	return abstractFeatures.count(featureName) > 0;
+}
+
+/**
+ * It returns the names of all the features represented in the MDD: those with their
+ * own variable, the children of ALT groups (values of the ALT variable), the mandatory
+ * leaves substituted by their parent and the children merged into AND/OR variables
+ *
+ * @return the sorted names of the features
+ */
+vector<string> FeatureVisitor::getFeatureNames() {
+	set<string> mergedParents;
+	for (map<string, pair<string, vector<string>>>::const_iterator it =
+			andLeafs.begin(); it != andLeafs.end(); ++it)
+		mergedParents.insert(it->second.first);
+
+	set<string> names;
+	for (map<string, vector<string>*>::const_iterator it = variables.begin();
+			it != variables.end(); ++it) {
+		names.insert(it->first);
+		// The values of merged variables are bit masks, those of boolean ones true/false
+		if (mergedParents.count(it->first) > 0)
+			continue;
+		for (const string &value : *it->second)
+			if (value != "NONE" && value != "true" && value != "false")
+				names.insert(value);
+	}
+	for (map<string, string>::const_iterator it = substitutions.begin();
+			it != substitutions.end(); ++it)
+		names.insert(it->first);
+	for (map<string, pair<string, vector<string>>>::const_iterator it =
+			andLeafs.begin(); it != andLeafs.end(); ++it)
+		names.insert(it->first);
+	return vector<string>(names.begin(), names.end());
+}
+
 vector<pair<pair<int, int>, vector<pair<int, int>>*>> FeatureVisitor::getOrIndexsNonLeaf() {
+	AllocTracker::Scope allocScope("indexCopies");
 	return orIndexsNonLeaf;
 }
 
@@ -894,6 +1066,7 @@ vector<pair<pair<int, int>, vector<pair<int, int>>*>> FeatureVisitor::getOrIndex
  * 		and w are their values
  */
 vector<pair<pair<int, int>, vector<pair<int, int>>*>> FeatureVisitor::getAltIndexesExclusion() {
+	AllocTracker::Scope allocScope("indexCopies");
 	return altIndexesExclusion;
 }
 
@@ -0,0 +1,113 @@
+/*
+ * PerfCounters.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "PerfCounters.hpp"
+#include "logger.hpp"
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+int PerfCounters::fds[PERF_NUM_COUNTERS] = { -1, -1, -1, -1 };
+bool PerfCounters::opened = false;
+bool PerfCounters::REQUESTED = false;
+const char *PerfCounters::NAMES[PERF_NUM_COUNTERS] = { "cycles",
+		"instructions", "llcMisses", "dtlbMisses" };
+
+static int openCounter(__u32 type, __u64 config) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// Needed to scale the values when the counters are multiplexed
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+			| PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * Opens and starts the counters for the current process
+ *
+ * @return true if at least one counter is available
+ */
+bool PerfCounters::open() {
+	close();
+	fds[PERF_CYCLES] = openCounter(PERF_TYPE_HARDWARE,
+			PERF_COUNT_HW_CPU_CYCLES);
+	fds[PERF_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE,
+			PERF_COUNT_HW_INSTRUCTIONS);
+	fds[PERF_LLC_MISSES] = openCounter(PERF_TYPE_HW_CACHE,
+			PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+					| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	fds[PERF_DTLB_MISSES] = openCounter(PERF_TYPE_HW_CACHE,
+			PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+					| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+	for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+		if (fds[i] < 0) {
+			LOGCOUT(LOG_WARNING) << "Hardware counter " << NAMES[i]
+					<< " not available: " << strerror(errno) << endl;
+			continue;
+		}
+		ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+		opened = true;
+	}
+	return opened;
+}
+
+void PerfCounters::close() {
+	for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+		if (fds[i] >= 0)
+			::close(fds[i]);
+		fds[i] = -1;
+	}
+	opened = false;
+}
+
+bool PerfCounters::isEnabled() {
+	return opened;
+}
+
+/**
+ * Reads the current value of each counter (-1 for the unavailable ones)
+ *
+ * @param values the array receiving the values, indexed by PERF_CYCLES, PERF_INSTRUCTIONS, ...
+ */
+void PerfCounters::read(long long values[PERF_NUM_COUNTERS]) {
+	for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+		// value, time enabled, time running
+		unsigned long long buffer[3];
+		if (fds[i] < 0 || ::read(fds[i], buffer, sizeof(buffer)) != sizeof(buffer)) {
+			values[i] = -1;
+		} else if (buffer[2] > 0 && buffer[2] < buffer[1]) {
+			values[i] = (long long) ((double) buffer[0] * buffer[1] / buffer[2]);
+		} else {
+			values[i] = buffer[0];
+		}
+	}
+}
+
+/**
+ * Ratio between two counters, e.g. instructions per cycle or misses per kilo-instruction
+ *
+ * @param numerator the numerator
+ * @param denominator the denominator
+ * @param scale the factor the ratio is multiplied by
+ * @return the scaled ratio, or -1 if one of the counters is unavailable
+ */
+double PerfCounters::ratio(long long numerator, long long denominator,
+		double scale) {
+	if (numerator < 0 || denominator <= 0)
+		return -1;
+	return scale * numerator / denominator;
+}
@@ -0,0 +1,392 @@
+/*
+ * QueryServer.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "QueryServer.hpp"
+#include "logger.hpp"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <thread>
+#include <sstream>
+#include <stdexcept>
+#include <gmpxx.h>
+
+// Longest request accepted: the connection is closed when a line gets longer
+#define SERVE_MAX_REQUEST (1 << 20)
+// Seconds a worker waits for a client that does not read its answers
+#define SERVE_SEND_TIMEOUT 10
+
+bool QueryServer::ALLOW_SHUTDOWN = false;
+
+QueryServer::QueryServer() :
+		listener(-1), wakeup { -1, -1 }, stopping(false) {
+}
+
+QueryServer::~QueryServer() {
+	for (auto &validator : validators)
+		delete validator.second;
+	for (auto &model : models)
+		delete model.second;
+}
+
+/**
+ * Loads a model, which is served until the server is destroyed
+ *
+ * @param name the name used in the requests
+ * @param fileName the flat snapshot written with --exportFlat
+ */
+void QueryServer::addModel(const string &name, const string &fileName) {
+	if (models.count(name))
+		throw std::invalid_argument("Duplicate model name: " + name);
+	models[name] = FlatMdd::open(fileName);
+	validators[name] = new FlatValidator(*models[name]);
+	LOGCOUT(LOG_INFO) << "Loaded model " << name << " from " << fileName << " ("
+			<< models[name]->getNumNodes() << " nodes)" << endl;
+}
+
+const FlatMdd& QueryServer::getModel(const string &name) const {
+	auto model = models.find(name);
+	if (model == models.end())
+		throw std::invalid_argument("Unknown model: " + name);
+	return *model->second;
+}
+
+/**
+ * Answers a single request (see the class description), but shutdown
+ *
+ * @param request the request, without the end of line
+ * @return the answer, without the end of line
+ */
+string QueryServer::answer(const string &request) {
+	istringstream words(request);
+	vector<string> args;
+	string word;
+	while (words >> word)
+		args.push_back(word);
+	if (args.empty())
+		return "error empty request";
+	const string &command = args[0];
+	try {
+		if (command == "models") {
+			string names = "ok";
+			for (auto &model : models)
+				names += " " + model.first;
+			return names;
+		}
+		if (args.size() < 2)
+			return "error missing model";
+		const FlatMdd &flat = getModel(args[1]);
+		ValueMask mask;
+		if (command == "count") {
+			for (unsigned int i = 2; i < args.size(); i++)
+				FlatCounter::assume(flat, args[i], mask);
+			return "ok " + FlatCounter::count(flat, 1, mask);
+		}
+		if (command == "validate") {
+			FlatValidator::Result result = validators.at(args[1])->validate(
+					vector<string>(args.begin() + 2, args.end()));
+			if (result.outcome == FlatValidator::UNKNOWN_FEATURE)
+				return "error Unknown feature: " + result.feature;
+			return result.outcome == FlatValidator::VALID ?
+					"ok valid" : "ok invalid";
+		}
+		if (command == "marginal") {
+			if (args.size() < 3)
+				return "error missing feature";
+			for (unsigned int i = 3; i < args.size(); i++)
+				FlatCounter::assume(flat, args[i], mask);
+			mpz_class total(FlatCounter::count(flat, 1, mask));
+			FlatCounter::assume(flat, args[2], mask);
+			mpz_class selected(FlatCounter::count(flat, 1, mask));
+			double ratio = (total == 0) ? 0 : mpq_class(selected, total).get_d();
+			return "ok " + selected.get_str() + " " + total.get_str() + " "
+					+ to_string(ratio);
+		}
+	} catch (std::exception &e) {
+		return string("error ") + e.what();
+	}
+	return "error unknown command " + command;
+}
+
+/**
+ * Whether the client of a connection may stop the server: shutdown must be allowed
+ * and the client must run as the same user as the server (or as root)
+ *
+ * @param fd the socket of the connection
+ */
+bool QueryServer::maySendShutdown(int fd) const {
+	if (!ALLOW_SHUTDOWN)
+		return false;
+	struct ucred credentials;
+	socklen_t length = sizeof(credentials);
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+		return false;
+	return credentials.uid == geteuid() || credentials.uid == 0;
+}
+
+/**
+ * Loop of a worker thread: answers the queued requests until the server is stopped
+ */
+void QueryServer::work() {
+	while (true) {
+		Request request;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			queued.wait(guard, [this] {
+				return stopping || !queue.empty();
+			});
+			if (stopping)
+				return;
+			request = queue.front();
+			queue.pop_front();
+		}
+		bool shutdownRequested = false;
+		string reply;
+		if (request.text == "shutdown") {
+			shutdownRequested = maySendShutdown(request.fd);
+			reply = shutdownRequested ? "ok" : "error shutdown not allowed";
+		} else {
+			reply = answer(request.text);
+		}
+		reply += "\n";
+		size_t sent = 0;
+		while (sent < reply.size()) {
+			ssize_t n = send(request.fd, reply.data() + sent, reply.size() - sent,
+					MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0) {
+				// The poll loop sees the end of the connection and closes it
+				shutdown(request.fd, SHUT_RDWR);
+				break;
+			}
+			sent += n;
+		}
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			connections[request.fd].busy = false;
+		}
+		if (shutdownRequested)
+			stop();
+		else
+			wake();
+	}
+}
+
+/**
+ * Wakes up the poll loop, so that it reads again the connections no longer busy
+ */
+void QueryServer::wake() {
+	const char byte = 0;
+	while (write(wakeup[1], &byte, 1) < 0 && errno == EINTR)
+		;
+}
+
+/**
+ * Accepts the pending connections (the listener is non-blocking)
+ */
+void QueryServer::acceptConnections() {
+	while (true) {
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			return;
+		}
+		struct timeval timeout = { SERVE_SEND_TIMEOUT, 0 };
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		connections[fd] = { "", false };
+	}
+}
+
+void QueryServer::closeConnection(int fd) {
+	connections.erase(fd);
+	close(fd);
+}
+
+/**
+ * Reads the data available on a connection, which is closed at the end of the stream
+ * or when a request is too long
+ *
+ * @param fd the socket of the connection
+ */
+void QueryServer::readConnection(int fd) {
+	char buffer[4096];
+	ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		return;
+	if (n <= 0) {
+		closeConnection(fd);
+		return;
+	}
+	string &pending = connections[fd].pending;
+	pending.append(buffer, n);
+	if (pending.size() > SERVE_MAX_REQUEST
+			&& pending.find('\n') == string::npos) {
+		LOGCOUT(LOG_WARNING) << "Request longer than " << SERVE_MAX_REQUEST
+				<< " bytes, connection closed" << endl;
+		closeConnection(fd);
+	}
+}
+
+/**
+ * Queues the next request of each connection that is not busy
+ */
+void QueryServer::dispatch() {
+	for (auto it = connections.begin(); it != connections.end();) {
+		const int fd = it->first;
+		Connection &connection = it->second;
+		// Advanced first, since the connection may be closed
+		++it;
+		size_t end;
+		if (connection.busy
+				|| (end = connection.pending.find('\n')) == string::npos)
+			continue;
+		string request = connection.pending.substr(0, end);
+		connection.pending.erase(0, end + 1);
+		if (!request.empty() && request.back() == '\r')
+			request.pop_back();
+		if (request == "quit") {
+			closeConnection(fd);
+			continue;
+		}
+		connection.busy = true;
+		queue.push_back( { fd, request });
+		queued.notify_one();
+	}
+}
+
+/**
+ * Loop of the main thread: waits for new connections and requests until the server is
+ * stopped. The connections busy with a request are not read, so the requests of a
+ * connection are answered in order.
+ */
+void QueryServer::pollRequests() {
+	vector<pollfd> fds;
+	while (!stopping) {
+		fds.clear();
+		fds.push_back( { wakeup[0], POLLIN, 0 });
+		fds.push_back( { listener, POLLIN, 0 });
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			for (auto &connection : connections)
+				if (!connection.second.busy)
+					fds.push_back( { connection.first, POLLIN, 0 });
+		}
+		if (::poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			throw std::runtime_error(string("Error waiting for requests: ")
+					+ strerror(errno));
+		}
+		char drained[64];
+		if (fds[0].revents)
+			while (read(wakeup[0], drained, sizeof(drained)) > 0)
+				;
+		std::lock_guard<std::mutex> guard(lock);
+		if (fds[1].revents)
+			acceptConnections();
+		for (size_t i = 2; i < fds.size(); i++)
+			if (fds[i].revents)
+				readConnection(fds[i].fd);
+		dispatch();
+	}
+}
+
+/**
+ * Removes the file of the socket left by a server that did not stop cleanly. Any other
+ * file, or the socket of a running server, is left in place and reported.
+ *
+ * @param address the address of the socket
+ */
+void QueryServer::removeStaleSocket(const sockaddr_un &address) {
+	const string path = address.sun_path;
+	struct stat st;
+	if (lstat(path.c_str(), &st) != 0)
+		return;
+	if (!S_ISSOCK(st.st_mode))
+		throw std::invalid_argument(path + " exists and is not a socket");
+	int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (probe < 0)
+		throw std::runtime_error("Cannot create a Unix socket");
+	const bool running = connect(probe, (const sockaddr*) &address,
+			sizeof(address)) == 0;
+	close(probe);
+	if (running)
+		throw std::invalid_argument("A server is already listening on " + path);
+	unlink(path.c_str());
+}
+
+/**
+ * Listens on the socket and serves the requests until shutdown (or stop) is called
+ *
+ * @param socketPath the path of the Unix domain socket (a stale socket is replaced)
+ * @param threads the number of worker threads
+ */
+void QueryServer::run(const string &socketPath, unsigned int threads) {
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path))
+		throw std::invalid_argument("Socket path too long: " + socketPath);
+	strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+	removeStaleSocket(address);
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+		throw std::runtime_error("Cannot create a Unix socket");
+	if (bind(listener, (sockaddr*) &address, sizeof(address)) < 0
+			|| listen(listener, SOMAXCONN) < 0 || pipe(wakeup) < 0) {
+		const string reason = strerror(errno);
+		close(listener);
+		throw std::runtime_error("Cannot listen on " + socketPath + ": " + reason);
+	}
+	fcntl(listener, F_SETFL, O_NONBLOCK);
+	fcntl(wakeup[0], F_SETFL, O_NONBLOCK);
+	fcntl(wakeup[1], F_SETFL, O_NONBLOCK);
+	LOGCOUT(LOG_INFO) << "Serving " << models.size() << " models on " << socketPath
+			<< " with " << threads << " threads" << endl;
+
+	vector<std::thread> pool;
+	for (unsigned int t = 0; t < std::max(threads, 1u); t++)
+		pool.push_back(std::thread(&QueryServer::work, this));
+	std::exception_ptr error;
+	try {
+		pollRequests();
+	} catch (...) {
+		error = std::current_exception();
+		stop();
+	}
+	for (std::thread &t : pool)
+		t.join();
+	for (auto &connection : connections)
+		close(connection.first);
+	connections.clear();
+	queue.clear();
+	close(listener);
+	close(wakeup[0]);
+	close(wakeup[1]);
+	unlink(socketPath.c_str());
+	if (error)
+		std::rethrow_exception(error);
+	LOGCOUT(LOG_INFO) << "Server stopped" << endl;
+}
+
+/**
+ * Stops the server: the workers end after the request they are answering and the
+ * connections are closed
+ */
+void QueryServer::stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	queued.notify_all();
+	wake();
+}
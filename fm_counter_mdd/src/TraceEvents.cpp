@@ -0,0 +1,149 @@
+/*
+ * TraceEvents.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "TraceEvents.hpp"
+#include "Metrics.hpp"
+#include <stdexcept>
+#include <unistd.h>
+
+ofstream TraceEvents::output;
+double TraceEvents::origin = 0;
+bool TraceEvents::first = true;
+
+TraceEvents::Span::Span(const string &name, const string &category) {
+	if (TraceEvents::isEnabled()) {
+		this->name = name;
+		this->category = category;
+		this->start = TraceEvents::now();
+	} else {
+		this->start = -1;
+	}
+}
+
+TraceEvents::Span::~Span() {
+	if (start >= 0 && TraceEvents::isEnabled())
+		TraceEvents::complete(name, category, start, TraceEvents::now() - start,
+				args);
+}
+
+/**
+ * Adds an argument to the span (shown by the trace viewer when the span is selected)
+ *
+ * @param key the name of the argument
+ * @param value its value
+ */
+void TraceEvents::Span::setArg(const string &key, const string &value) {
+	if (start < 0)
+		return;
+	if (!args.empty())
+		args += ", ";
+	args += "\"" + Metrics::jsonEscape(key) + "\": \""
+			+ Metrics::jsonEscape(value) + "\"";
+}
+
+/**
+ * Starts writing the trace to the given file
+ *
+ * @param fileName the name of the JSON file
+ */
+void TraceEvents::open(const string &fileName) {
+	output.open(fileName, ios::out | ios::trunc);
+	if (!output.is_open())
+		throw std::invalid_argument("Cannot open trace file " + fileName);
+	origin = Metrics::wallTime();
+	first = true;
+	output << "[";
+}
+
+/**
+ * Terminates the JSON array and closes the file
+ */
+void TraceEvents::close() {
+	if (!output.is_open())
+		return;
+	output << "\n]\n";
+	output.close();
+}
+
+bool TraceEvents::isEnabled() {
+	return output.is_open();
+}
+
+/**
+ * Microseconds elapsed since the trace has been opened
+ *
+ * @return the timestamp of the current instant
+ */
+double TraceEvents::now() {
+	return (Metrics::wallTime() - origin) * 1e6;
+}
+
+void TraceEvents::writeEventHeader(const string &name,
+		const string &category, char phase, double ts) {
+	output << (first ? "\n" : ",\n") << "{\"name\": \"" << Metrics::jsonEscape(name)
+			<< "\", \"cat\": \"" << category << "\", \"ph\": \"" << phase
+			<< "\", \"pid\": 1, \"tid\": 1, \"ts\": " << (long long) ts;
+	first = false;
+}
+
+/**
+ * Writes a complete event
+ *
+ * @param name the name of the span
+ * @param category the category of the span (e.g., phase, visitor, ctc)
+ * @param start the timestamp of the beginning of the span, in microseconds
+ * @param duration the duration of the span, in microseconds
+ * @param args the arguments of the event, as the content of a JSON object
+ */
+void TraceEvents::complete(const string &name, const string &category,
+		double start, double duration, const string &args) {
+	if (!isEnabled())
+		return;
+	writeEventHeader(name, category, 'X', start);
+	output << ", \"dur\": " << (long long) duration;
+	if (!args.empty())
+		output << ", \"args\": {" << args << "}";
+	output << "}";
+}
+
+/**
+ * Writes a sample of a counter track
+ *
+ * @param name the name of the counter
+ * @param value the current value
+ */
+void TraceEvents::counter(const string &name, double value) {
+	if (!isEnabled())
+		return;
+	writeEventHeader(name, "counter", 'C', now());
+	output << ", \"args\": {\"value\": " << value << "}}";
+}
+
+/**
+ * Writes a sample of the live nodes of the forest and of the resident memory
+ *
+ * @param mdd the forest
+ */
+void TraceEvents::forestCounters(forest *mdd) {
+	if (!isEnabled())
+		return;
+	counter("liveNodes", mdd->getCurrentNumNodes());
+	counter("rssKb", getCurrentRSS());
+	output.flush();
+}
+
+/**
+ * Current resident set size of the process, read from /proc/self/statm
+ *
+ * @return the RSS in kilobytes (-1 if not available)
+ */
+long TraceEvents::getCurrentRSS() {
+	ifstream statm("/proc/self/statm");
+	long pages, resident;
+	if (!(statm >> pages >> resident))
+		return -1;
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
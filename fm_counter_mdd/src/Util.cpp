@@ -6,6 +6,9 @@
 
 #include "Util.hpp"
 #include <chrono>
+#include <gmpxx.h>
+#include <sstream>
+#include <algorithm>
 
 bool Util::IGNORE_HIDDEN = false;
 bool Util::SORT_CONSTRAINTS_WHEN_APPLYING = false;
@@ -14,6 +17,12 @@ bool Util::PRINT_MDD = true;
 bool Util::REORDER_VARIABLES = true;
 double Util::N_MAX_NODES = 0;
 double Util::N_MAX_EDGES = 0;
+string Util::CTC_TRACE_FILE = "";
+string Util::SAVE_MDD_FILE = "";
+vector<vector<string>> Util::ASSUMPTIONS;
+string Util::FLAT_MDD_FILE = "";
+dd_edge *Util::FINAL_ROOT = NULL;
+FeatureVisitor *Util::FINAL_VISITOR = NULL;
 
 /**
  * Given the file name, it returns the count of the products
@@ -67,32 +76,121 @@ string Util::getProductCountFromFile(string fileName, bool ignore,
  */
 string Util::getProductCountFromFile(string fileName, int reduction_factor_ctc) {
 	// Open and read the file, then visit it
-	std::string *fileToString = Util::parseXML(fileName);
+	std::string *fileToString;
+	{
+		Metrics::PhaseTimer timer(PHASE_READ);
+		fileToString = Util::parseXML(fileName);
+	}
 	// Parse the file
 	xml_document<> doc;
-	doc.parse<0>(const_cast<char*>(fileToString->c_str()));
+	{
+		Metrics::PhaseTimer timer(PHASE_PARSE);
+		doc.parse<0>(const_cast<char*>(fileToString->c_str()));
+	}
 	xml_node<> *structNode = doc.first_node()->first_node("struct");
 
 	FeatureVisitor v(IGNORE_HIDDEN);
-	v.visit(structNode->first_node());
+	{
+		Metrics::PhaseTimer timer(PHASE_VISIT);
+		v.visit(structNode->first_node());
+		v.readFeatureTree(structNode->first_node());
+	}
+	Budget::check(PHASE_VISIT, 0);
 	v.printDefinedVariables();
+	// Unknown features in the assumptions are reported before the (long) build
+	checkAssumptions(v);
 
-	// Init MEDDLY
-	initialize();
+	// We have 3 variables, all booleans
+	const int N = v.getNVar();
+	int *bounds = v.getBounds();
+	forest *mdd;
+	{
+		Metrics::PhaseTimer timer(PHASE_FOREST);
+		// Init MEDDLY
+		initialize();
+		mdd = createForest(bounds, N);
+	}
+	Metrics::setValue("variables", N);
+	// Display forest properties
+	LOGCOUT(LOG_DEBUG) << "Created forest in this domain with:"
+			<< "\n  Relation:\tfalse" << "\n  Range Type:\tBOOLEAN"
+			<< "\n  Edge Label:\tMULTI_TERMINAL" << "\n";
+	// Create an edge representing the terminal node TRUE
+	dd_edge emptyNode(mdd);
+	dd_edge startingNode(mdd);
+	mdd->createEdge(true, startingNode);
+	mdd->createEdge(true, emptyNode);
+
+	// Add the constraints of the feature tree, unless a checkpoint that already contains
+	// them is resumed (it is loaded together with the cross-tree constraints)
+	Checkpoint::setContext(fileName, reduction_factor_ctc, bounds, N);
+	if (Checkpoint::RESUME_FILE.empty())
+		addFeatureTreeConstraints(N, emptyNode, v, mdd, startingNode);
 
+	// Add Cross Tree Constraints
+	xml_node<> *constraintNode = structNode->parent()->first_node(
+			"constraints");
+	// Add Cross Tree Constraints
+	if (constraintNode != NULL) {
+		addCrossTreeConstraints(v, emptyNode, startingNode, constraintNode, mdd,
+				reduction_factor_ctc, fileToString->c_str());
+	} else if (!Checkpoint::RESUME_FILE.empty()) {
+		throw std::invalid_argument("Cannot resume " + Checkpoint::RESUME_FILE
+				+ ": the model has no cross-tree constraints");
+	}
+	// Cardinality
+	string count;
+	{
+		Metrics::PhaseTimer timer(PHASE_COUNT);
+		count = cardinality(startingNode);
+	}
+	LOGCOUT(LOG_INFO) << "Number of valid products: "
+			<< count << endl;
+	Metrics::setValue("finalNodes", startingNode.getNodeCount());
+	LevelProfiler::checkpoint("final", 0, startingNode, v);
+	Metrics::setValue("finalEdges", startingNode.getEdgeCount());
+	Metrics::collectForestStats(mdd);
+
+	if (!SAVE_MDD_FILE.empty()) {
+		MddFile::save(SAVE_MDD_FILE, startingNode, v);
+	}
+	keepFinalMdd(startingNode, v);
+
+	if (PRINT_MDD) {
+		dot_maker mdd_dot(mdd, "MDD");
+		mdd_dot.addRootEdge(startingNode);
+		mdd_dot.doneGraph();
+	}
+
+	mdd->removeAllComputeTableEntries();
+	mdd->removeStaleComputeTableEntries();
+
+	delete fileToString;
+	delete bounds;
+
+	return count;
+}
+
+/**
+ * Creates the domain and the forest used to represent the products: one variable for
+ * each FeatureVisitor variable (the i-th variable of the visitor is the MEDDLY
+ * variable i+1), boolean terminals and fully reduced nodes
+ *
+ * @param bounds the number of values of each variable
+ * @param N the number of variables
+ * @return the new forest
+ */
+forest* Util::createForest(const int *bounds, const int N) {
 	// Create a domain
 	domain *d = domain::create();
 	assert(d != 0);
-	// We have 3 variables, all booleans
-	const int N = v.getNVar();
-	int *bounds = v.getBounds();
 	// Create variable in the above domain
 	d->createVariablesBottomUp(bounds, N);
-	logcout(LOG_DEBUG) << "Created domain with " << d->getNumVariables()
+	LOGCOUT(LOG_DEBUG) << "Created domain with " << d->getNumVariables()
 			<< " variables\n";
-	logcout(LOG_DEBUG) << "Bounds: " << endl;
+	LOGCOUT(LOG_DEBUG) << "Bounds: " << endl;
 	for (int i = 0; i < N; i++)
-		logcout(LOG_DEBUG) << "\t" << bounds[i] << endl;
+		LOGCOUT(LOG_DEBUG) << "\t" << bounds[i] << endl;
 	// Do not reduce the forest
 	policies pmdd(false);
 	pmdd.setFullyReduced();
@@ -104,100 +202,355 @@ string Util::getProductCountFromFile(string fileName, int reduction_factor_ctc)
 			edge_labeling::MULTI_TERMINAL, 	 // disables edge-labeling
 			pmdd);
 	assert(mdd != 0);
-	// Display forest properties
-	logcout(LOG_DEBUG) << "Created forest in this domain with:"
-			<< "\n  Relation:\tfalse" << "\n  Range Type:\tBOOLEAN"
-			<< "\n  Edge Label:\tMULTI_TERMINAL" << "\n";
-	// Create an edge representing the terminal node TRUE
-	dd_edge emptyNode(mdd);
-	dd_edge startingNode(mdd);
-	mdd->createEdge(true, startingNode);
-	mdd->createEdge(true, emptyNode);
-	// Cardinality
-
-#ifdef __GMP_H__
-	mpz_t card;
-	mpz_init(card);
-#else
-	double card;
-#endif
+	return mdd;
+}
 
-	apply(CARDINALITY,startingNode, card);
-	logcout(LOG_DEBUG) << "Initial cardinality: " << card << endl;
+/**
+ * Adds to startingNode the constraints of the feature tree: mandatory features, OR and
+ * ALT groups and the implications between children and parents
+ *
+ * @param N the number of variables
+ * @param emptyNode the edge representing the terminal node TRUE
+ * @param v the visitor of the feature tree
+ * @param mdd the forest
+ * @param startingNode the MDD being built
+ */
+void Util::addFeatureTreeConstraints(const int N, const dd_edge &emptyNode,
+		FeatureVisitor &v, forest *mdd, dd_edge &startingNode) {
+	LOGCOUT(LOG_DEBUG) << "Initial cardinality: " << cardinality(startingNode) << endl;
 
 	// Add the mandatory constraint for the root
-	dd_edge c = addMandatory(emptyNode, N, v, mdd);
-	// Intersect this edge with the starting node
-	startingNode *= c;
+	dd_edge c(mdd);
+	{
+		Metrics::PhaseTimer timer(PHASE_MANDATORY);
+		c = addMandatory(emptyNode, N, v, mdd);
+		// Intersect this edge with the starting node
+		startingNode *= c;
+	}
+	LevelProfiler::checkpoint(PHASE_MANDATORY, 0, startingNode, v);
+	TraceEvents::forestCounters(mdd);
+	Heartbeat::update(startingNode);
+	checkBudget(PHASE_MANDATORY, startingNode);
 
 	// Cardinality
-	apply(CARDINALITY,startingNode, card);
-	logcout(LOG_DEBUG)
+	LOGCOUT(LOG_DEBUG)
 			<< "Cardinality after mandatory constraints [usually for root]: "
-			<< card << endl;
+			<< cardinality(startingNode) << endl;
 
 	// Add the mandatory constraint for the other features
-	addMandatoryNonLeaf(N, emptyNode, v, c, mdd, startingNode);
+	{
+		Metrics::PhaseTimer timer(PHASE_MANDATORY_NON_LEAF);
+		addMandatoryNonLeaf(N, emptyNode, v, c, mdd, startingNode);
+	}
+	LevelProfiler::checkpoint(PHASE_MANDATORY_NON_LEAF, 0, startingNode, v);
+	TraceEvents::forestCounters(mdd);
+	Heartbeat::update(startingNode);
+	checkBudget(PHASE_MANDATORY_NON_LEAF, startingNode);
 	// Cardinality
-	apply(CARDINALITY,startingNode, card);
-	logcout(LOG_DEBUG) << "Cardinality after mandatory for other features: "
-			<< card << endl;
+	LOGCOUT(LOG_DEBUG) << "Cardinality after mandatory for other features: "
+			<< cardinality(startingNode) << endl;
 
 	// Add the OR constraints
-	addOrGroupConstraints(v, emptyNode, N, startingNode, mdd);
+	{
+		Metrics::PhaseTimer timer(PHASE_OR);
+		addOrGroupConstraints(v, emptyNode, N, startingNode, mdd);
+	}
+	LevelProfiler::checkpoint(PHASE_OR, 0, startingNode, v);
+	TraceEvents::forestCounters(mdd);
+	Heartbeat::update(startingNode);
+	checkBudget(PHASE_OR, startingNode);
 	// Cardinality
-	apply(CARDINALITY,startingNode, card);
-	logcout(LOG_DEBUG) << "Cardinality after OR groups: "
-			<< card << endl;
+	LOGCOUT(LOG_DEBUG) << "Cardinality after OR groups: "
+			<< cardinality(startingNode) << endl;
 
 	// Add the constraints for alternatives converted as boolean
-	addAltGroupConstraints(v, emptyNode, N, startingNode, mdd);
+	{
+		Metrics::PhaseTimer timer(PHASE_ALT);
+		addAltGroupConstraints(v, emptyNode, N, startingNode, mdd);
+	}
+	LevelProfiler::checkpoint(PHASE_ALT, 0, startingNode, v);
+	TraceEvents::forestCounters(mdd);
+	Heartbeat::update(startingNode);
+	checkBudget(PHASE_ALT, startingNode);
 	// Cardinality
-	apply(CARDINALITY,startingNode, card);
-	logcout(LOG_DEBUG) << "Cardinality after special ALT groups: "
-			<< card << endl;
+	LOGCOUT(LOG_DEBUG) << "Cardinality after special ALT groups: "
+			<< cardinality(startingNode) << endl;
 
 	// Add single implication constraints for each feature: a feature can be
 	// included only if the parent is included
-	addSingleImplications(N, emptyNode, v, c, mdd, startingNode);
+	{
+		Metrics::PhaseTimer timer(PHASE_IMPLICATIONS);
+		addSingleImplications(N, emptyNode, v, c, mdd, startingNode);
+	}
+	LevelProfiler::checkpoint(PHASE_IMPLICATIONS, 0, startingNode, v);
+	TraceEvents::forestCounters(mdd);
+	Heartbeat::update(startingNode);
+	checkBudget(PHASE_IMPLICATIONS, startingNode);
 	// Cardinality
-	apply(CARDINALITY,startingNode, card);
-	logcout(LOG_DEBUG)
+	LOGCOUT(LOG_DEBUG)
 			<< "Final cardinality after dependencies between features: "
-			<< card << endl;
+			<< cardinality(startingNode) << endl;
+}
 
-	// Add Cross Tree Constraints
-	xml_node<> *constraintNode = structNode->parent()->first_node(
-			"constraints");
-	// Add Cross Tree Constraints
-	if (constraintNode != NULL) {
-		addCrossTreeConstraints(v, emptyNode, startingNode, constraintNode, mdd,
-				reduction_factor_ctc);
+/**
+ * Checkpoint after a structural phase: checks the budgets (see Budget). The size is
+ * computed only when some budget is active, so it does not update the peaks N_MAX_NODES
+ * and N_MAX_EDGES: they would depend on whether a budget is given.
+ *
+ * @param phase the phase just completed
+ * @param startingNode the root of the MDD being built
+ */
+void Util::checkBudget(const string &phase, const dd_edge &startingNode) {
+	if (!Budget::isActive())
+		return;
+	Budget::check(phase, startingNode.getNodeCount());
+}
+
+/**
+ * Given a compiled model saved with SAVE_MDD_FILE, it returns the count of the products
+ *
+ * @param fileName the name of the MDD file
+ * @return the number of valid products
+ */
+string Util::getProductCountFromMddFile(string fileName) {
+	initialize();
+	FeatureVisitor v;
+	dd_edge root;
+	{
+		Metrics::PhaseTimer timer(PHASE_READ);
+		root = MddFile::load(fileName, v);
 	}
-	// Cardinality
-	apply(CARDINALITY,startingNode, card);
-	logcout(LOG_INFO) << "Number of valid products: "
-			<< card << endl;
+	checkAssumptions(v);
+	string count;
+	{
+		Metrics::PhaseTimer timer(PHASE_COUNT);
+		count = cardinality(root);
+	}
+	LOGCOUT(LOG_INFO) << "Number of valid products: "
+			<< count << endl;
+	keepFinalMdd(root, v);
+	return count;
+}
 
-	if (PRINT_MDD) {
-		dot_maker mdd_dot(mdd, "MDD");
-		mdd_dot.addRootEdge(startingNode);
-		mdd_dot.doneGraph();
+/**
+ * Restricts an MDD to the products satisfying a list of feature literals. The names
+ * are resolved through the tables of the visitor, so the literals can refer to the
+ * features substituted by their parent, to the children of ALT groups and to the
+ * features merged into compressed AND variables.
+ *
+ * @param root the MDD
+ * @param literals the literals: a feature name, or !name for a deselected feature
+ * @param v the visitor that encoded the model
+ * @return the restricted MDD
+ */
+dd_edge Util::restrictToLiterals(const dd_edge &root,
+		const vector<string> &literals, FeatureVisitor &v) {
+	forest *mdd = root.getForest();
+	const int N = v.getNVar();
+	dd_edge restricted = root;
+	for (const string &literal : literals) {
+		const bool negated = !literal.empty() && literal[0] == '!';
+		const string name = negated ? literal.substr(1) : literal;
+		pair<int, vector<int>> selecting = v.getSelectingValues(name);
+		if (selecting.first < 0)
+			throw std::invalid_argument("Unknown feature: " + name);
+		// Union of the values of the variable compatible with the literal
+		dd_edge allowed(mdd);
+		for (int value = 0; value < v.getBoundForVar(selecting.first); value++) {
+			bool selects = std::find(selecting.second.begin(),
+					selecting.second.end(), value) != selecting.second.end();
+			if (selects == negated)
+				continue;
+			vector<int> constraint(N, -1);
+			constraint[N - selecting.first - 1] = value;
+			allowed += getMDDFromTuple(constraint, mdd);
+		}
+		restricted *= allowed;
 	}
+	return restricted;
+}
 
-	mdd->removeAllComputeTableEntries();
-	mdd->removeStaleComputeTableEntries();
+/**
+ * Splits a line of whitespace-separated feature literals
+ *
+ * @param line the line
+ * @return the literals
+ */
+vector<string> Util::splitLiterals(const string &line) {
+	istringstream words(line);
+	vector<string> literals;
+	string literal;
+	while (words >> literal)
+		literals.push_back(literal);
+	return literals;
+}
 
-	delete fileToString;
-	delete bounds;
+/**
+ * Adds to ASSUMPTIONS the assumption sets of a file, one per line (empty lines and
+ * lines starting with # are skipped)
+ *
+ * @param fileName the name of the file
+ */
+void Util::readAssumptions(const string &fileName) {
+	ifstream input(fileName);
+	if (!input.is_open())
+		throw std::invalid_argument("Cannot open assumption file " + fileName);
+	string line;
+	while (getline(input, line)) {
+		vector<string> literals = splitLiterals(line);
+		if (!literals.empty() && literals[0][0] != '#')
+			ASSUMPTIONS.push_back(literals);
+	}
+}
+
+/**
+ * Checks that the files written after a count (the flat snapshot and the analyses of
+ * FlatReports) can be opened, so that a wrong path is reported before the build
+ */
+void Util::checkOutputFiles() {
+	if (!FLAT_MDD_FILE.empty()) {
+		ofstream output(FLAT_MDD_FILE, ios::app);
+		if (!output.is_open())
+			throw std::invalid_argument("Cannot open flat MDD " + FLAT_MDD_FILE);
+	}
+	FlatReports::checkFiles();
+}
 
+/**
+ * Checks that every literal of ASSUMPTIONS names a feature of the model
+ *
+ * @param v the visitor that encoded the model
+ */
+void Util::checkAssumptions(FeatureVisitor &v) {
+	for (const vector<string> &literals : ASSUMPTIONS)
+		for (const string &literal : literals) {
+			const string name = literal[0] == '!' ? literal.substr(1) : literal;
+			if (v.getSelectingValues(name).first < 0)
+				throw std::invalid_argument("Unknown feature in assumption "
+						+ joinLiterals(literals) + ": " + name);
+		}
+}
+
+/**
+ * Writes to stdout the number of products under each set of ASSUMPTIONS, as lines
+ * "literals;count". MEDDLY has no batched cardinality, so every set is a restriction
+ * and a count: for large batches use a flat snapshot (see FlatCounter::countBatch).
+ *
+ * @param root the final MDD
+ * @param v the visitor that encoded the model
+ */
+void Util::writeConditionalCounts(const dd_edge &root, FeatureVisitor &v) {
+	for (const vector<string> &literals : ASSUMPTIONS) {
+		string count = cardinality(restrictToLiterals(root, literals, v));
+		cout << joinLiterals(literals) << ";" << count << endl;
+	}
+}
+
+/**
+ * Keeps the final MDD of a count for writeAnalyses, if there is something to write
+ *
+ * @param root the final MDD
+ * @param v the visitor that encoded the model
+ */
+void Util::keepFinalMdd(const dd_edge &root, const FeatureVisitor &v) {
+	if (ASSUMPTIONS.empty() && FLAT_MDD_FILE.empty()
+			&& !FlatReports::isRequested())
+		return;
+	delete FINAL_ROOT;
+	delete FINAL_VISITOR;
+	FINAL_ROOT = new dd_edge(root);
+	FINAL_VISITOR = new FeatureVisitor(v);
+}
+
+/**
+ * Writes the analyses of the final MDD kept by the last count, then releases it. They
+ * are not part of the count: the caller writes its result first, so that a failing
+ * analysis does not lose it. The error of an analysis is logged and does not stop
+ * the others.
+ *
+ * @return whether every analysis has been written
+ */
+bool Util::writeAnalyses() {
+	if (FINAL_ROOT == NULL)
+		return true;
+	bool written = true;
+	try {
+		exportFlat(*FINAL_ROOT, *FINAL_VISITOR);
+	} catch (std::exception &e) {
+		LOGCOUT(LOG_ERROR) << "Flat analyses failed: " << e.what() << endl;
+		written = false;
+	}
+	try {
+		writeConditionalCounts(*FINAL_ROOT, *FINAL_VISITOR);
+	} catch (std::exception &e) {
+		LOGCOUT(LOG_ERROR) << "Conditional counts failed: " << e.what() << endl;
+		written = false;
+	}
+	delete FINAL_ROOT;
+	delete FINAL_VISITOR;
+	FINAL_ROOT = NULL;
+	FINAL_VISITOR = NULL;
+	return written;
+}
+
+/**
+ * Joins a list of literals with spaces
+ */
+string Util::joinLiterals(const vector<string> &literals) {
+	string joined;
+	for (const string &literal : literals)
+		joined += (joined.empty() ? "" : " ") + literal;
+	return joined;
+}
+
+/**
+ * Counts the assignments accepted by an MDD with the CARDINALITY operation of MEDDLY.
+ * This is the only place that depends on how MEDDLY has been built: the count is
+ * exact with GMP, a double otherwise.
+ *
+ * @param e the root edge
+ * @return the number of assignments, in base 10
+ */
+string Util::cardinality(const dd_edge &e) {
 #ifdef __GMP_H__
-	return mpz_get_str(NULL, 10, card);
+	mpz_t card;
+	mpz_init(card);
+	apply(CARDINALITY, e, card);
+	mpz_class count(card);
+	mpz_clear(card);
+	return count.get_str();
 #else
+	double card;
+	apply(CARDINALITY, e, card);
 	return to_string(card);
 #endif
 }
 
+/**
+ * Writes the flat snapshot of the MDD (see FlatMdd) to FLAT_MDD_FILE, if it is set,
+ * and the analyses requested in FlatReports, which work on the same flat form
+ *
+ * @param root the root of the MDD
+ * @param v the visitor that defined the variables of the MDD
+ */
+void Util::exportFlat(const dd_edge &root, FeatureVisitor &v) {
+	if (FLAT_MDD_FILE.empty() && !FlatReports::isRequested())
+		return;
+	FlatMdd *flat = FlatMdd::fromEdge(root, v);
+	try {
+		if (!FLAT_MDD_FILE.empty()) {
+			flat->write(FLAT_MDD_FILE);
+			LOGCOUT(LOG_INFO) << "Flat MDD with " << flat->getNumNodes()
+					<< " nodes written to " << FLAT_MDD_FILE << endl;
+		}
+		FlatReports::write(*flat);
+	} catch (...) {
+		delete flat;
+		throw;
+	}
+	delete flat;
+}
+
 /**
  * Prints the valid elements, by extracting them from an MDD
  *
@@ -223,6 +576,7 @@ void Util::printElements(std::ostream &strm, dd_edge &e) {
  * @return the starting edge of the new MDD representing the tuple of interest
  */
 dd_edge Util::getMDDFromTuple(vector<int> tupla, forest *mdd) {
+	AllocTracker::Scope allocScope("tuple");
 	const int N = tupla.size();
 
 	// Create an element to insert in the MDD
@@ -285,7 +639,7 @@ dd_edge Util::addMandatory(const dd_edge &emptyNode, const int N,
 	vector<int> indxs = v.getMandatoryIndex();
 	for (unsigned int i = 0; i < indxs.size(); i++) {
 		int noneIndex = v.getIndexOfNoneForVariable(indxs[i]);
-		logcout(LOG_DEBUG) << "Variable with index " << indxs[i]
+		LOGCOUT(LOG_DEBUG) << "Variable with index " << indxs[i]
 				<< " set as MANDATORY" << endl;
 		constraint[N - indxs[i] - 1] = noneIndex;
 	}
@@ -302,7 +656,7 @@ void Util::addOrGroupConstraints(FeatureVisitor v, const dd_edge emptyNode,
 	// Add the OR constraints
 	vector<pair<pair<int, int>, vector<int>*>> orIndxs = v.getOrIndexs();
 	for (unsigned int i = 0; i < orIndxs.size(); i++) {
-		logcout(LOG_DEBUG)
+		LOGCOUT(LOG_DEBUG)
 				<< "Adding constraint for OR-Group elements with their root [Index: "
 				<< orIndxs[i].first.first << ", None Value: "
 				<< v.getValueForVar(orIndxs[i].first.first,
@@ -312,11 +666,12 @@ void Util::addOrGroupConstraints(FeatureVisitor v, const dd_edge emptyNode,
 		constraint[N - orIndxs[i].first.first - 1] = orIndxs[i].first.second;
 		c = Util::getMDDFromTuple(constraint, mdd) * emptyNode;
 		vector<int> *idx = orIndxs[i].second;
-		cout << "\t" << idx->size() << endl;
+		LOGCOUT(LOG_DEBUG) << "\t" << idx->size() << endl;
 		for (unsigned int j = 0; j < idx->size(); j++) {
 			constraint = vector<int>(N, -1);
 			constraint[N - idx->data()[j] - 1] = 1;
-			Util::printVector(constraint, logcout(LOG_DEBUG));
+			if (LOG_ENABLED(LOG_DEBUG))
+				Util::printVector(constraint, logcout(LOG_DEBUG));
 			if (j == 0)
 				cTemp = Util::getMDDFromTuple(constraint, mdd);
 			else
@@ -333,7 +688,7 @@ void Util::addOrGroupConstraints(FeatureVisitor v, const dd_edge emptyNode,
 	vector<pair<pair<int, int>, vector<pair<int, int>>*>> orIndxNonLeaf =
 			v.getOrIndexsNonLeaf();
 	for (unsigned int i = 0; i < orIndxNonLeaf.size(); i++) {
-		logcout(LOG_DEBUG)
+		LOGCOUT(LOG_DEBUG)
 				<< "Adding constraint for OR-Group elements with their root [Index: "
 				<< orIndxNonLeaf[i].first.first << ", NoneValue: "
 				<< v.getValueForVar(orIndxNonLeaf[i].first.first,
@@ -348,7 +703,8 @@ void Util::addOrGroupConstraints(FeatureVisitor v, const dd_edge emptyNode,
 		for (unsigned int j = 0; j < idx->size(); j++) {
 			constraint = vector<int>(N, -1);
 			constraint[N - idx->data()[j].first - 1] = idx->data()[j].second;
-			Util::printVector(constraint, logcout(LOG_DEBUG));
+			if (LOG_ENABLED(LOG_DEBUG))
+				Util::printVector(constraint, logcout(LOG_DEBUG));
 			dd_edge thisConstraint = Util::getMDDFromTuple(constraint, mdd);
 			thisConstraint = emptyNode - thisConstraint;
 			if (j == 0)
@@ -370,7 +726,7 @@ void Util::addAltGroupConstraints(FeatureVisitor v, const dd_edge emptyNode,
 	vector<pair<pair<int, int>, vector<pair<int, int>>*>> altIndexesExclusion =
 			v.getAltIndexesExclusion();
 	for (pair<pair<int, int>, vector<pair<int, int>>*> vAlt : altIndexesExclusion) {
-		logcout(LOG_DEBUG)
+		LOGCOUT(LOG_DEBUG)
 				<< "Adding constraint for ALT-Group elements with their root [Index: "
 				<< vAlt.first.first << ", None Value: "
 				<< v.getValueForVar(vAlt.first.first, vAlt.first.second)
@@ -438,7 +794,7 @@ void Util::addMandatoryNonLeaf(const int N, const dd_edge &emptyNode,
 	vector<pair<pair<int, int>, pair<int, int> > > mandatoryImplications =
 			v.getMandatoryImplications();
 	for (unsigned int i = 0; i < mandatoryImplications.size(); i++) {
-		logcout(LOG_DEBUG) << "Adding constraint [Index: "
+		LOGCOUT(LOG_DEBUG) << "Adding constraint [Index: "
 				<< mandatoryImplications[i].first.first << ", Value: "
 				<< v.getValueForVar(mandatoryImplications[i].first.first,
 						mandatoryImplications[i].first.second)
@@ -479,20 +835,12 @@ void Util::addMandatoryNonLeaf(const int N, const dd_edge &emptyNode,
 
 		// C = A <=> B
 		apply(EQUAL, tempC, tempC1, c);
-#ifdef __GMP_H__
-		mpz_t card;
-		mpz_init(card);
-#else
-		double card;
-#endif
-		apply(CARDINALITY,c, card);
-		logcout(LOG_DEBUG) << "\tConstraint cardinality: " << card
+		LOGCOUT(LOG_DEBUG) << "\tConstraint cardinality: " << cardinality(c)
 				<< endl;
 		// Intersect this edge with the starting node
 		startingNode *= c;
-		apply(CARDINALITY,startingNode, card);
-		logcout(LOG_DEBUG) << "\tNew cardinality: "
-				<< card << endl;
+		LOGCOUT(LOG_DEBUG) << "\tNew cardinality: "
+				<< cardinality(startingNode) << endl;
 	}
 }
 
@@ -502,7 +850,7 @@ void Util::addSingleImplications(const int N, const dd_edge &emptyNode,
 	vector<pair<pair<int, int>, pair<int, int> > > singleImplications =
 			v.getSingleImplications();
 	for (unsigned int i = 0; i < singleImplications.size(); i++) {
-		logcout(LOG_DEBUG) << "Adding constraint [Index: "
+		LOGCOUT(LOG_DEBUG) << "Adding constraint [Index: "
 				<< singleImplications[i].second.first << ", Value: "
 				<< v.getValueForVar(singleImplications[i].second.first,
 						singleImplications[i].second.second) << "] => [Index: "
@@ -527,26 +875,18 @@ void Util::addSingleImplications(const int N, const dd_edge &emptyNode,
 		// C = A => B = notA or B
 		tempC = emptyNode - tempC;
 		c = tempC + tempC1;
-#ifdef __GMP_H__
-		mpz_t card;
-		mpz_init(card);
-#else
-		double card;
-#endif
-		apply(CARDINALITY,startingNode, card);
-		logcout(LOG_DEBUG) << "\tConstraint cardinality: " << card
+		LOGCOUT(LOG_DEBUG) << "\tConstraint cardinality: " << cardinality(c)
 				<< endl;
 		// Intersect this edge with the starting node
 		startingNode *= c;
-		apply(CARDINALITY,startingNode, card);
-		logcout(LOG_DEBUG) << "\tNew cardinality: "
-				<< card << endl;
+		LOGCOUT(LOG_DEBUG) << "\tNew cardinality: "
+				<< cardinality(startingNode) << endl;
 	}
 
 	// Add the mandatory constraint for the other features non leaf
 	singleImplications = v.getSingleImplicationsNonLeaf();
 	for (unsigned int i = 0; i < singleImplications.size(); i++) {
-		logcout(LOG_DEBUG) << "Adding constraint for dependency not[Index: "
+		LOGCOUT(LOG_DEBUG) << "Adding constraint for dependency not[Index: "
 				<< singleImplications[i].second.first << ", Value: "
 				<< v.getValueForVar(singleImplications[i].second.first,
 						singleImplications[i].second.second) << "] => [Index: "
@@ -570,28 +910,42 @@ void Util::addSingleImplications(const int N, const dd_edge &emptyNode,
 		tempC1 = Util::getMDDFromTuple(constraint, mdd) * emptyNode;
 		// C = A => B = notA or B
 		c = tempC + tempC1;
-		double card;
-		apply(CARDINALITY,startingNode, card);
-		logcout(LOG_DEBUG) << "\tConstraint cardinality: " << card
+		LOGCOUT(LOG_DEBUG) << "\tConstraint cardinality: " << cardinality(c)
 				<< endl;
 		// Intersect this edge with the starting node
 		startingNode *= c;
-		apply(CARDINALITY,startingNode, card);
-		logcout(LOG_DEBUG) << "\tNew cardinality: "
-				<< card << endl;
+		LOGCOUT(LOG_DEBUG) << "\tNew cardinality: "
+				<< cardinality(startingNode) << endl;
 	}
 }
 
 /**
- * Comparator used for comparing edges in an MDD
+ * Opens the cross-tree constraint trace (see CTC_TRACE_FILE). When resuming a
+ * checkpoint, the rows of the constraints applied before the checkpoint are kept and
+ * the new rows are appended to them.
  *
- * @param e1 the first edge
- * @param e2 the second edge
- * @return TRUE if the number of edges of the MDD starting with e1 is lower than that of e2,
- *         FALSE otherwise
+ * @param trace the stream to be opened
+ * @param firstConstraint the number of constraints applied by the resumed checkpoint
  */
-bool compareEdges(dd_edge e1, dd_edge e2) {
-	return (e1.getNodeCount() < e2.getNodeCount());
+static void openTrace(ofstream &trace, unsigned int firstConstraint) {
+	vector<string> kept;
+	if (firstConstraint > 0) {
+		ifstream previous(Util::CTC_TRACE_FILE);
+		string row;
+		// Skips the header, then keeps the rows whose step is not after the checkpoint
+		getline(previous, row);
+		while (getline(previous, row)) {
+			if (strtoul(row.c_str(), NULL, 10) <= firstConstraint)
+				kept.push_back(row);
+		}
+	}
+	trace.open(Util::CTC_TRACE_FILE, ios::out | ios::trunc);
+	if (!trace.is_open())
+		throw std::invalid_argument("Cannot open trace file " + Util::CTC_TRACE_FILE);
+	trace << "step;elapsed;rules;line;constraint;support;compiledNodes;compileTime;"
+			<< "applyTime;nodesBefore;edgesBefore;nodesAfter;edgesAfter;reordered;reorderTime\n";
+	for (const string &row : kept)
+		trace << row << "\n";
 }
 
 /**
@@ -602,6 +956,11 @@ bool compareEdges(dd_edge e1, dd_edge e2) {
  * Finally, the constraints are applied to the MDD by computing the intersection with the
  * current initial node of the MDD.
  *
+ * When Checkpoint::RESUME_FILE is set, the checkpoint is loaded after the constraints have
+ * been compiled and sorted (the order depends on the sizes of their MDDs, which change
+ * with the variable order restored by the checkpoint) and the constraints it already
+ * contains are skipped.
+ *
  * @param v the FeatureVisitor, used for accessing to variables information
  * @param emptyNode the empty node
  * @param startingNode the initial node of the MDD being built
@@ -609,65 +968,204 @@ bool compareEdges(dd_edge e1, dd_edge e2) {
  * @param mdd the forest
  * @param reduction_factor the reduction factor to be used for compressing constraints
  *   before applying them to the MDD
+ * @param source the buffer the XML document has been parsed from (used by the trace)
  */
 void Util::addCrossTreeConstraints(const FeatureVisitor v,
 		const dd_edge emptyNode, dd_edge &startingNode,
-		xml_node<> *constraintNode, forest *mdd, int reduction_factor) {
+		xml_node<> *constraintNode, forest *mdd, int reduction_factor,
+		const char *source) {
 	ConstraintVisitor cVisitor(v, emptyNode, mdd);
+	ofstream trace;
+	if (!CTC_TRACE_FILE.empty()) {
+		cVisitor.setSource(source);
+		ConstraintVisitor::COLLECT_INFO = true;
+	}
 	int i = 0;
 	// Visit the sub-tree for constraints and create a set of edges for each of them
-	cVisitor.visit(constraintNode, reduction_factor);
+	{
+		Metrics::PhaseTimer timer(PHASE_CTC_COMPILE);
+		cVisitor.visit(constraintNode, reduction_factor);
+	}
 	// Now, compute the intersection between startingNode and each of the constraint
 	vector<dd_edge> constraintList = cVisitor.getConstraintMddList();
+	vector<ConstraintInfo> infoList = cVisitor.getConstraintInfoList();
+	Metrics::setValue("appliedConstraints", constraintList.size());
+	// The sizes are computed once, and only if the sort or the checkpoints need them
+	const bool needSizes = SORT_CONSTRAINTS_WHEN_APPLYING
+			|| Checkpoint::isEnabled() || !Checkpoint::RESUME_FILE.empty();
+	vector<unsigned long> sizes(needSizes ? constraintList.size() : 0);
+	for (unsigned int k = 0; k < sizes.size(); k++)
+		sizes[k] = constraintList[k].getNodeCount();
 	// Order the vector from the lowest cardinality to the highest
 	if (SORT_CONSTRAINTS_WHEN_APPLYING) {
-		sort(constraintList.begin(), constraintList.end(), compareEdges);
+		vector<int> order(constraintList.size());
+		for (unsigned int k = 0; k < order.size(); k++)
+			order[k] = k;
+		sort(order.begin(), order.end(), [&sizes](int a, int b) {
+			return sizes[a] < sizes[b];
+		});
+		vector<dd_edge> sortedList;
+		vector<ConstraintInfo> sortedInfo;
+		vector<unsigned long> sortedSizes;
+		for (int k : order) {
+			sortedList.push_back(constraintList[k]);
+			sortedInfo.push_back(infoList[k]);
+			sortedSizes.push_back(sizes[k]);
+		}
+		constraintList = sortedList;
+		infoList = sortedInfo;
+		sizes = sortedSizes;
 	}
-	// Apply the constraints
-	i = 0;
-#ifdef __GMP_H__
-	mpz_t card;
-	mpz_init(card);
-#else
-	double card;
-#endif
+	Checkpoint::setConstraints(sizes);
+	// When resuming a checkpoint, the first constraints are already applied
+	unsigned int firstConstraint = 0;
+	double elapsedBefore = 0;
+	if (!Checkpoint::RESUME_FILE.empty()) {
+		Metrics::PhaseTimer timer(PHASE_RESUME);
+		firstConstraint = Checkpoint::load(Checkpoint::RESUME_FILE,
+				startingNode, elapsedBefore);
+	}
+	if (!CTC_TRACE_FILE.empty())
+		openTrace(trace, firstConstraint);
+	Metrics::PhaseTimer applyTimer(PHASE_CTC_APPLY);
+	Heartbeat::startConstraints(firstConstraint, constraintList.size());
+	i = firstConstraint;
 
-	int oldNodes = 0;
+	Metrics::setValue("constraintsApplied", firstConstraint);
+	int oldNodes = (firstConstraint > 0) ? startingNode.getNodeCount() : 0;
+	// The elapsed time of the trace and of the checkpoints continues the resumed one
+	double traceStart = Metrics::wallTime() - elapsedBefore;
+	unsigned long nodesBefore = trace.is_open() ? startingNode.getNodeCount() : 0;
+	unsigned long edgesBefore = trace.is_open() ? startingNode.getEdgeCount() : 0;
 
-	for (dd_edge& e : constraintList) {
+	for (unsigned int k = firstConstraint; k < constraintList.size(); k++) {
+		dd_edge& e = constraintList[k];
 		try {
-			startingNode *= e;
+			double applyStart = Metrics::wallTime();
+			{
+				TraceEvents::Span span("ctc " + to_string(k + 1), "ctc");
+				if (TraceEvents::isEnabled()) {
+					string rules;
+					for (int r : infoList[k].rules)
+						rules += (rules.empty() ? "" : "+") + to_string(r);
+					span.setArg("rules", rules);
+				}
+				startingNode *= e;
+			}
+			double applyTime = Metrics::wallTime() - applyStart;
+			double reorderTime = -1;
 
 			unsigned long nodes = startingNode.getNodeCount();
 			if (Util::REORDER_VARIABLES && i != 0 && (long unsigned int)i != constraintList.size() - 1) {
 				if ((nodes > 1.5 * oldNodes && nodes < 1000000 && nodes > 100000) || (nodes > 1.1 * oldNodes && nodes > 1000000)) {
-					logcout(LOG_DEBUG) << "\t\tStart reordering" << endl;
-					mdd->removeAllComputeTableEntries();
-					int numVariables = mdd->getNumVariables();
-					mdd->dynamicReorderVariables(numVariables,1);
-					logcout(LOG_DEBUG) << "\t\tEnd reordering" << endl;
+					LOGCOUT(LOG_DEBUG) << "\t\tStart reordering" << endl;
+					LevelProfiler::checkpoint("beforeReorder", i + 1, startingNode, v);
+					{
+						Metrics::PhaseTimer timer(PHASE_REORDER);
+						TraceEvents::Span span("dynamicReorderVariables", "reorder");
+						double reorderStart = Metrics::wallTime();
+						mdd->removeAllComputeTableEntries();
+						int numVariables = mdd->getNumVariables();
+						mdd->dynamicReorderVariables(numVariables,1);
+						reorderTime = Metrics::wallTime() - reorderStart;
+					}
+					LevelProfiler::checkpoint("afterReorder", i + 1, startingNode, v);
+					LOGCOUT(LOG_DEBUG) << "\t\tEnd reordering" << endl;
 				}
 			}
 
-			apply(CARDINALITY,startingNode, card);
-			logcout(LOG_DEBUG) << "\tNew cardinality after constraint " << (++i)
-					<< ": " << card << " - Edges: "
+			++i;
+			LOGCOUT(LOG_DEBUG) << "\tNew cardinality after constraint " << i
+					<< ": " << cardinality(startingNode) << " - Edges: "
 					<< startingNode.getEdgeCount() << " - Nodes: "
 					<< nodes << endl;
-			e.detach();
 
-			if (startingNode.getNodeCount() > N_MAX_NODES)
-				N_MAX_NODES = startingNode.getNodeCount();
+			unsigned long currentNodes = startingNode.getNodeCount();
+			if (currentNodes > N_MAX_NODES)
+				N_MAX_NODES = currentNodes;
 
-			if (startingNode.getEdgeCount()> N_MAX_EDGES)
-				N_MAX_EDGES = startingNode.getEdgeCount();
+			unsigned long currentEdges = startingNode.getEdgeCount();
+			if (currentEdges > N_MAX_EDGES)
+				N_MAX_EDGES = currentEdges;
+
+			TraceEvents::forestCounters(mdd);
+			Heartbeat::setConstraints(i, constraintList.size());
+			Heartbeat::setForest(currentNodes, currentEdges,
+					mdd->getPeakNumNodes());
+
+			if (LevelProfiler::isStep(i)) {
+				LevelProfiler::checkpoint(PHASE_CTC_APPLY, i, startingNode, v);
+			}
+
+			if (trace.is_open()) {
+				writeTraceRow(trace, i, Metrics::wallTime() - traceStart,
+						infoList[k], e.getNodeCount(), applyTime, nodesBefore,
+						edgesBefore, currentNodes, currentEdges, reorderTime);
+				nodesBefore = currentNodes;
+				edgesBefore = currentEdges;
+			}
+			e.detach();
 
 			oldNodes = nodes;
+			// The trace is flushed with the checkpoints, which a resumed run continues
+			if (Checkpoint::isDue()) {
+				if (trace.is_open())
+					trace.flush();
+				Checkpoint::save(startingNode, i, Metrics::wallTime() - traceStart);
+			}
+			Budget::check(PHASE_CTC_APPLY, currentNodes);
 
+		} catch(BudgetExceeded&) {
+			Metrics::setValue("constraintsApplied", i);
+			// A stopped run (e.g., preempted by SIGTERM) can be resumed from here
+			if (trace.is_open())
+				trace.flush();
+			if (Checkpoint::isEnabled())
+				Checkpoint::save(startingNode, i, Metrics::wallTime() - traceStart);
+			throw;
 		} catch(MEDDLY::error& e) {
 			cerr   << "\nCaught meddly error '" << e.getName()
 				<< "'\n thrown in " << e.getFile()
 				<< " line " << e.getLine() << "\n";
 		}
 	}
+	if (trace.is_open())
+		trace.flush();
+	Metrics::setValue("constraintsApplied", i);
+}
+
+/**
+ * Writes a row of the cross-tree constraint trace (see CTC_TRACE_FILE), without
+ * flushing it: the trace is flushed with the checkpoints and after the last constraint
+ *
+ * @param trace the output stream of the trace
+ * @param step the number of constraints applied so far
+ * @param elapsed the seconds elapsed since the first constraint has been applied
+ * @param info the information about the applied constraint
+ * @param compiledNodes the number of nodes of the MDD of the constraint
+ * @param applyTime the seconds spent computing the intersection with the MDD
+ * @param nodesBefore the nodes of the MDD before applying the constraint
+ * @param edgesBefore the edges of the MDD before applying the constraint
+ * @param nodesAfter the nodes of the MDD after applying the constraint
+ * @param edgesAfter the edges of the MDD after applying the constraint
+ * @param reorderTime the seconds spent reordering the variables (-1 if no reordering has been done)
+ */
+void Util::writeTraceRow(std::ostream &trace, int step, double elapsed,
+		const ConstraintInfo &info, unsigned long compiledNodes,
+		double applyTime, unsigned long nodesBefore, unsigned long edgesBefore,
+		unsigned long nodesAfter, unsigned long edgesAfter,
+		double reorderTime) {
+	trace << step << ";" << elapsed << ";";
+	for (unsigned int r = 0; r < info.rules.size(); r++)
+		trace << (r == 0 ? "" : "+") << info.rules[r];
+	// The constraint is quoted, since feature names may contain the separator
+	string text = info.text;
+	for (size_t pos = text.find('"'); pos != string::npos;
+			pos = text.find('"', pos + 2))
+		text.replace(pos, 1, "\"\"");
+	trace << ";" << info.line << ";\"" << text << "\";" << info.support.size()
+			<< ";" << compiledNodes << ";" << info.compileTime << ";"
+			<< applyTime << ";" << nodesBefore << ";" << edgesBefore << ";"
+			<< nodesAfter << ";" << edgesAfter << ";" << (reorderTime >= 0)
+			<< ";" << (reorderTime >= 0 ? reorderTime : 0) << "\n";
 }
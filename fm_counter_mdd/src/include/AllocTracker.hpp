@@ -0,0 +1,51 @@
+/*
+ * AllocTracker.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_ALLOCTRACKER_HPP_
+#define INCLUDE_ALLOCTRACKER_HPP_
+
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+// Maximum number of distinct phases and call site categories that can be tracked
+#define ALLOC_MAX_PHASES 32
+#define ALLOC_MAX_CATEGORIES 16
+
+/**
+ * Counts the allocations done through operator new (number, bytes and peak live bytes)
+ * for each pipeline phase and for each call site category.
+ *
+ * The global operator new/delete are replaced only when the program is compiled with
+ * FM_TRACK_ALLOCATIONS (meson option track_allocations); otherwise all the methods are
+ * cheap no-ops and isEnabled() returns false. Memory allocated by MEDDLY through malloc
+ * (e.g., the node storage) is not tracked: it is reported by the forest statistics.
+ */
+class AllocTracker {
+public:
+	/**
+	 * Scoped category: the allocations done while the object is alive are attributed
+	 * to the given call site category
+	 */
+	class Scope {
+	private:
+		int previous;
+	public:
+		Scope(const char *category);
+		~Scope();
+	};
+
+	static bool isEnabled();
+	static int enterPhase(const string &name);
+	static void leavePhase(int previous);
+	static void writeJson(std::ostream &out);
+	static unsigned long long getAllocations();
+	static unsigned long long getAllocatedBytes();
+	static unsigned long long getPeakLiveBytes();
+};
+
+#endif /* INCLUDE_ALLOCTRACKER_HPP_ */
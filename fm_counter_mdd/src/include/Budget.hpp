@@ -0,0 +1,64 @@
+/*
+ * Budget.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_BUDGET_HPP_
+#define INCLUDE_BUDGET_HPP_
+
+#include <string>
+#include <stdexcept>
+
+using namespace std;
+
+// Exit codes of FMBuilderExperimenter when the build is stopped before the end
+#define BUDGET_EXIT_TIME 3
+#define BUDGET_EXIT_NODES 4
+#define BUDGET_EXIT_MEMORY 5
+#define BUDGET_EXIT_SIGNAL 6
+
+// Seconds between a termination signal and the forced stop, if no checkpoint is reached
+#define BUDGET_SIGNAL_GRACE 30
+
+/**
+ * Thrown by Budget::check when a budget is exhausted or a termination signal
+ * has been received
+ */
+class BudgetExceeded: public std::runtime_error {
+public:
+	// "time", "nodes", "memory" or "signal"
+	const string reason;
+	// The phase in which the budget has been exhausted
+	const string phase;
+
+	BudgetExceeded(const string &reason, const string &phase);
+	int getExitCode() const;
+};
+
+/**
+ * Time, node and memory budgets of a build.
+ *
+ * Budgets are checked at the checkpoints of the pipeline (after each phase and after
+ * each cross-tree constraint), so a single long operation is never interrupted.
+ * When a limit is set, SIGTERM and SIGINT are turned into a BudgetExceeded at the next
+ * checkpoint; a second signal, or a checkpoint not reached within BUDGET_SIGNAL_GRACE
+ * seconds, terminates the process with the default action of the signal.
+ */
+class Budget {
+private:
+	static double startTime;
+public:
+	static void start();
+	static void installSignalHandlers();
+	static bool isActive();
+	static void check(const string &phase, unsigned long nodes);
+	static double elapsed();
+
+	// Limits (0 = no limit)
+	static double TIME_LIMIT;
+	static unsigned long NODE_LIMIT;
+	static long MEMORY_LIMIT_KB;
+};
+
+#endif /* INCLUDE_BUDGET_HPP_ */
@@ -0,0 +1,60 @@
+/*
+ * Checkpoint.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_CHECKPOINT_HPP_
+#define INCLUDE_CHECKPOINT_HPP_
+
+#include <meddly.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace MEDDLY;
+
+/**
+ * Checkpoints of the cross-tree phase.
+ *
+ * A checkpoint contains the MDD built so far (written with the MEDDLY edge
+ * serialization), the variable order of the forest, the index of the next constraint
+ * to be applied, the time spent applying constraints and the peak sizes. It also
+ * records the model, the reduction factor, the variable bounds and the size of each
+ * constraint in the order they are applied, so that it is never resumed with a
+ * different setup or a different sequence of constraints.
+ *
+ * The constraints are compiled and sorted before the checkpoint is loaded, since
+ * loading changes the variable order and the sort depends on the sizes of the MDDs.
+ *
+ * Files are written to a temporary file and then renamed, so a run killed while
+ * saving leaves the previous checkpoint intact.
+ */
+class Checkpoint {
+private:
+	static string model;
+	static int reductionFactor;
+	static vector<int> bounds;
+	static vector<unsigned long> constraintSizes;
+	static double lastSave;
+
+public:
+	static void setContext(const string &model, int reductionFactor,
+			const int *bounds, int N);
+	static void setConstraints(const vector<unsigned long> &sizes);
+	static bool isEnabled();
+	static bool isDue();
+	static void save(const dd_edge &root, unsigned int nextConstraint,
+			double elapsed);
+	static unsigned int load(const string &fileName, dd_edge &root,
+			double &elapsed);
+
+	// File written periodically (empty = no checkpoints)
+	static string FILE_NAME;
+	// Seconds between two checkpoints
+	static double INTERVAL;
+	// Checkpoint to be resumed (empty = build from scratch)
+	static string RESUME_FILE;
+};
+
+#endif /* INCLUDE_CHECKPOINT_HPP_ */
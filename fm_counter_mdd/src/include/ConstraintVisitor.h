@@ -17,17 +17,45 @@
 #include <algorithm>
 #include "logger.hpp"
 #include <random>
+#include <set>
+#include "Metrics.hpp"
 
 using namespace std;
 using namespace rapidxml;
 using namespace MEDDLY;
 
+/**
+ * Information about a (possibly compacted) cross-tree constraint, used for profiling
+ */
+struct ConstraintInfo {
+	// Ordinals (from 1) of the <rule> elements compacted in this constraint
+	vector<int> rules;
+	// Line of the first rule in the source file (0 if unknown)
+	int line = 0;
+	// Infix representation (only when ConstraintVisitor::COLLECT_INFO is set)
+	string text;
+	// Indexes of the MDD variables the constraint depends on
+	set<int> support;
+	// Time spent building the MDD of the constraint, in seconds
+	double compileTime = 0;
+
+	void merge(const ConstraintInfo &other);
+};
+
 class ConstraintVisitor {
 private:
 	FeatureVisitor visitor;
 	dd_edge emptyNode;
 	forest* mdd;
 	vector<dd_edge> constraintMddList;
+	vector<ConstraintInfo> constraintInfoList;
+	set<int> currentSupport;
+	const char* source;
+	const char* sourcePosition;
+	int sourceLine;
+
+	int getLine(const char* position);
+	string toString(xml_node<> * node);
 
 	dd_edge visitConstraint(xml_node<> * node);
 	dd_edge visitConj(xml_node<> * node);
@@ -43,6 +71,10 @@ public:
 	void visit(xml_node<> * &node, int reduction_factor);
 	void visit(xml_node<> * &node);
 	vector<dd_edge> getConstraintMddList();
+	vector<ConstraintInfo> getConstraintInfoList();
+	void setSource(const char* source);
+
+	static bool COLLECT_INFO;
 };
 
 #endif /* CONSTRAINTVISITOR_H_ */
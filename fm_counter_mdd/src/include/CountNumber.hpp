@@ -0,0 +1,182 @@
+/*
+ * CountNumber.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_COUNTNUMBER_HPP_
+#define INCLUDE_COUNTNUMBER_HPP_
+
+#include <gmpxx.h>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <sstream>
+
+using namespace std;
+
+/*
+ * Number types for the counting passes of FlatCounter. Each type defines:
+ *
+ *   value_type                  the value stored for each node
+ *   zero(), one()               the counts of the terminals false and true
+ *   addProduct(acc, c, w)       acc += c * w, where w is the weight of an edge
+ *   fromMpz(x)                  the conversion of an exact weight
+ *   toString(x)                 the printed count
+ *
+ * Counts only need sums and multiplications by weights, so every type that supports
+ * them can be used: the modular and the logarithmic counts are much cheaper than GMP
+ * on large models.
+ */
+
+/**
+ * Exact count with GMP
+ */
+struct MpzNumber {
+	typedef mpz_class value_type;
+	static value_type zero() {
+		return 0;
+	}
+	static value_type one() {
+		return 1;
+	}
+	static void addProduct(value_type &acc, const value_type &count,
+			const value_type &weight) {
+		mpz_addmul(acc.get_mpz_t(), count.get_mpz_t(), weight.get_mpz_t());
+	}
+	static value_type fromMpz(const mpz_class &x) {
+		return x;
+	}
+	static string toString(const value_type &x) {
+		return x.get_str();
+	}
+};
+
+/**
+ * Approximate count in double precision (inf when larger than about 1.8e308)
+ */
+struct DoubleNumber {
+	typedef double value_type;
+	static value_type zero() {
+		return 0;
+	}
+	static value_type one() {
+		return 1;
+	}
+	static void addProduct(value_type &acc, value_type count, value_type weight) {
+		acc += count * weight;
+	}
+	static value_type fromMpz(const mpz_class &x) {
+		return x.get_d();
+	}
+	static string toString(value_type x) {
+		ostringstream out;
+		out.precision(17);
+		out << x;
+		return out.str();
+	}
+};
+
+/**
+ * Count modulo 2^64: the arithmetic wraps around, so it is exact up to 2^64 - 1 and
+ * can be used as a cheap checksum of the exact count above
+ */
+struct Mod64Number {
+	typedef uint64_t value_type;
+	static value_type zero() {
+		return 0;
+	}
+	static value_type one() {
+		return 1;
+	}
+	static void addProduct(value_type &acc, value_type count, value_type weight) {
+		acc += count * weight;
+	}
+	static value_type fromMpz(const mpz_class &x) {
+		mpz_class low;
+		mpz_fdiv_r_2exp(low.get_mpz_t(), x.get_mpz_t(), 64);
+		value_type result = 0;
+		mpz_export(&result, NULL, -1, sizeof(result), 0, 0, low.get_mpz_t());
+		return result;
+	}
+	static string toString(value_type x) {
+		return to_string(x) + " (mod 2^64)";
+	}
+};
+
+/**
+ * Exact count in 128 bits: std::overflow_error is thrown if it does not fit
+ */
+struct Int128Number {
+	typedef unsigned __int128 value_type;
+	static value_type zero() {
+		return 0;
+	}
+	static value_type one() {
+		return 1;
+	}
+	static void addProduct(value_type &acc, value_type count, value_type weight) {
+		value_type term;
+		if (__builtin_mul_overflow(count, weight, &term)
+				|| __builtin_add_overflow(acc, term, &acc))
+			throw std::overflow_error("The count does not fit in 128 bits");
+	}
+	static value_type fromMpz(const mpz_class &x) {
+		if (mpz_sizeinbase(x.get_mpz_t(), 2) > 128)
+			throw std::overflow_error("The count does not fit in 128 bits");
+		value_type result = 0;
+		mpz_export(&result, NULL, -1, sizeof(result), 0, 0, x.get_mpz_t());
+		return result;
+	}
+	static string toString(value_type x) {
+		string digits;
+		do {
+			digits.insert(digits.begin(), (char) ('0' + (int) (x % 10)));
+			x /= 10;
+		} while (x > 0);
+		return digits;
+	}
+};
+
+/**
+ * Natural logarithm of the count, for an order of magnitude that never overflows.
+ * The count 0 is -inf.
+ */
+struct LogNumber {
+	typedef double value_type;
+	static value_type zero() {
+		return -numeric_limits<double>::infinity();
+	}
+	static value_type one() {
+		return 0;
+	}
+	static void addProduct(value_type &acc, value_type count, value_type weight) {
+		value_type term = count + weight;
+		if (term == zero())
+			return;
+		if (acc < term)
+			std::swap(acc, term);
+		acc += std::log1p(std::exp(term - acc));
+	}
+	static value_type fromMpz(const mpz_class &x) {
+		if (x == 0)
+			return zero();
+		long exponent;
+		double mantissa = mpz_get_d_2exp(&exponent, x.get_mpz_t());
+		return std::log(mantissa) + exponent * std::log(2.0);
+	}
+	static string toString(value_type x) {
+		if (x == zero())
+			return "0";
+		double decimal = x / std::log(10.0);
+		double exponent = std::floor(decimal);
+		ostringstream out;
+		out.precision(6);
+		out << std::pow(10.0, decimal - exponent) << "e+" << (long) exponent;
+		return out.str();
+	}
+};
+
+#endif /* INCLUDE_COUNTNUMBER_HPP_ */
@@ -0,0 +1,81 @@
+/*
+ * FlatCounter.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATCOUNTER_HPP_
+#define INCLUDE_FLATCOUNTER_HPP_
+
+#include <gmpxx.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include "FlatMdd.hpp"
+
+using namespace std;
+
+/**
+ * Values allowed for each variable, indexed by variable (1..N) and value: an empty
+ * mask, or an empty vector for a variable, allows every value
+ */
+typedef vector<vector<char>> ValueMask;
+
+/**
+ * Parallel counting over a FlatMdd.
+ *
+ * The levels are processed one at a time (bottom-up or top-down) and the nodes of a
+ * level are split among the threads, which synchronize on a barrier at the end of
+ * each level.
+ *
+ * The count of a node n is the number of assignments of all the N variables that
+ * satisfy the function of n, the variables above the level of n being free. In this
+ * way, skipped levels need no correction: the count of a node of level l is the sum
+ * of the counts of its children divided by the bound of level l, the count of the
+ * terminal true is the size of the whole domain, and the count of the root is the
+ * number of products. These counts (countNodes) are all as large as the domain, so
+ * count() uses a different, mixed-precision scheme (see FlatCounter.cpp). The same
+ * scheme can be run with other number types (exact, modular, approximate), selected
+ * at runtime, and restricted to a partial configuration (ValueMask): the disallowed
+ * values of each variable are simply not followed.
+ */
+class FlatCounter {
+public:
+	static void forEachNodeByLevel(const FlatMdd &flat, unsigned int threads,
+			bool bottomUp, const function<void(uint32_t)> &visit,
+			const function<void(uint32_t)> &prepareLevel = nullptr);
+	static void countNodes(const FlatMdd &flat, unsigned int threads,
+			vector<mpz_class> &counts);
+	static mpz_class domainSize(const FlatMdd &flat);
+	static string count(const FlatMdd &flat, unsigned int threads,
+			const ValueMask &mask = ValueMask());
+	static string count(const FlatMdd &flat, unsigned int threads,
+			const string &numberType, const ValueMask &mask = ValueMask());
+	static vector<string> countBatch(const FlatMdd &flat, unsigned int threads,
+			const vector<ValueMask> &masks);
+	static void assume(const FlatMdd &flat, const string &literal,
+			ValueMask &mask);
+	static unsigned int defaultThreads();
+	static bool computePrefixes(const FlatMdd &flat, const ValueMask &mask,
+			vector<mpz_class> &prefix);
+	static void computeNodeLevels(const FlatMdd &flat, vector<uint32_t> &levelOf);
+	static void markChildLevels(const FlatMdd &flat,
+			const vector<uint32_t> &levelOf, uint32_t level, vector<char> &used);
+
+	/**
+	 * The values allowed for a variable
+	 *
+	 * @return NULL if every value is allowed, a flag for each value otherwise
+	 */
+	static const char* allowedValues(const ValueMask &mask, uint32_t variable) {
+		return (mask.empty() || mask[variable].empty()) ?
+				NULL : mask[variable].data();
+	}
+
+private:
+	template<class Number>
+	static string countAs(const FlatMdd &flat, unsigned int threads,
+			const ValueMask &mask);
+};
+
+#endif /* INCLUDE_FLATCOUNTER_HPP_ */
@@ -0,0 +1,44 @@
+/*
+ * FlatEnumerator.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATENUMERATOR_HPP_
+#define INCLUDE_FLATENUMERATOR_HPP_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "FlatMdd.hpp"
+
+using namespace std;
+
+/**
+ * Parallel enumeration of the products of a FlatMdd into a bit-packed binary file.
+ *
+ * The products are split in tasks by cofactors: starting from the root, a task with
+ * too many products is replaced by one task for each value of its top level, so the
+ * tasks are small and in the order of FlatRanker. The threads enumerate the tasks
+ * with a depth-first walk into their own buffers, which are written in order: the
+ * file does not depend on the number of threads.
+ *
+ * File layout (native byte order):
+ *
+ *   "FMPROD1" version nVariables recordSize count bounds[1..N]
+ *   records
+ *
+ * version, nVariables and bounds are 32 bits, recordSize and count 64 bits. Each record
+ * is a product: the value of variable i takes ceil(log2(bound(i))) bits, from the
+ * variable 1 and from the least significant bit of the first byte, and the record is
+ * padded to whole bytes. decodeCsv translates the records to values or feature names.
+ */
+class FlatEnumerator {
+public:
+	static uint64_t writeBinary(const FlatMdd &flat, unsigned int threads,
+			const string &fileName);
+	static uint64_t decodeCsv(const FlatMdd &flat, const string &binaryFileName,
+			const string &csvFileName, bool featureNames);
+};
+
+#endif /* INCLUDE_FLATENUMERATOR_HPP_ */
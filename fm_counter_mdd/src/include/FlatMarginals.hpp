@@ -0,0 +1,53 @@
+/*
+ * FlatMarginals.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATMARGINALS_HPP_
+#define INCLUDE_FLATMARGINALS_HPP_
+
+#include <gmpxx.h>
+#include <string>
+#include <vector>
+#include "FlatMdd.hpp"
+#include "FlatCounter.hpp"
+
+using namespace std;
+
+/**
+ * Number of products with each value of each variable, and with each feature
+ * selected, computed for all of them at once.
+ *
+ * A bottom-up pass computes for each node the number of assignments of the levels
+ * below it reaching the terminal true, a top-down pass the number of assignments of
+ * the levels above it reaching it from the root. The products through an edge are
+ * the product of the two (times the size of the skipped levels), and they are added
+ * to the value of the edge. Edges skipping a level do not fix its variable: their
+ * products are spread evenly over its allowed values.
+ */
+class FlatMarginals {
+public:
+	// Classes of the features, derived from their marginal counts
+	enum FeatureClass {
+		FEATURE_VARIANT,		// selected in some products, but not in all
+		FEATURE_CORE,			// selected in every product
+		FEATURE_DEAD,			// selected in no product
+		FEATURE_FALSE_OPTIONAL	// optional, but selected whenever its parent is
+	};
+
+	static mpz_class countValues(const FlatMdd &flat, unsigned int threads,
+			const ValueMask &mask, vector<vector<mpz_class>> &valueCounts);
+	static mpz_class countFeatures(const FlatMdd &flat, unsigned int threads,
+			const ValueMask &mask, vector<mpz_class> &selected);
+	static void writeCsv(const FlatMdd &flat, unsigned int threads,
+			const string &fileName);
+	static double ratio(const mpz_class &part, const mpz_class &total);
+	static mpz_class classifyFeatures(const FlatMdd &flat, unsigned int threads,
+			vector<FeatureClass> &classes);
+	static const char* getClassName(FeatureClass c);
+	static void writeFeatureClasses(const FlatMdd &flat, unsigned int threads,
+			const string &fileName, vector<uint32_t> &classCounts);
+};
+
+#endif /* INCLUDE_FLATMARGINALS_HPP_ */
@@ -0,0 +1,187 @@
+/*
+ * FlatMdd.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATMDD_HPP_
+#define INCLUDE_FLATMDD_HPP_
+
+#include <meddly.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include "NodeFeatureVisitor.h"
+
+using namespace std;
+using namespace MEDDLY;
+
+// Ids of the terminal nodes
+#define FLAT_FALSE 0
+#define FLAT_TRUE 1
+// Parent of the features whose parent is not in the snapshot
+#define FLAT_NO_PARENT 0xFFFFFFFFu
+// Flags of the features
+#define FLAT_FEATURE_OPTIONAL 1u
+#define FLAT_FEATURE_PARENT_ROOT 2u
+#define FLAT_FEATURE_ABSTRACT 4u
+
+/**
+ * Read-only MDD stored as flat arrays, traversed without MEDDLY.
+ *
+ * Node ids are 32-bit and sorted by level, from the terminals (level 0, ids 0 and 1)
+ * up to the top level: the nodes of level l are [getLevelStart(l), getLevelStart(l+1)),
+ * so every child has a smaller id than its parent. The children of node n are
+ * getChildren(n)[0..getNumChildren(n)), one for each value of the variable of its
+ * level (CSR layout). An edge may skip levels: the skipped variables are free.
+ *
+ * Levels go from 1 (bottom) to N; variables are the MEDDLY variables (variable i is
+ * the FeatureVisitor variable i-1). The file also contains the names of the variables,
+ * the labels of their values and, for each feature, the variable encoding it, the
+ * values selecting it, its parent in the feature tree and whether it is optional or
+ * abstract. The features of the model without a variable (e.g., the root or the
+ * abstract features of groups) are only listed by name.
+ *
+ * The file is a header followed by 8-byte aligned sections, and it is used in place
+ * when opened with open() (mmap, pages shared between processes).
+ */
+class FlatMdd {
+public:
+	// Sections of the file, each one an array of uint32_t (but SECTION_STRINGS)
+	enum Section {
+		SECTION_LEVEL_VAR,			// variable of each level [N+1]
+		SECTION_VAR_LEVEL,			// level of each variable [N+1]
+		SECTION_VAR_BOUND,			// number of values of each variable [N+1]
+		SECTION_LEVEL_START,		// first node of each level [N+2]
+		SECTION_CHILD_START,		// first child of each node [nodes+1]
+		SECTION_CHILDREN,			// children [children]
+		SECTION_VAR_NAME,			// name of each variable (string offset) [N+1]
+		SECTION_LABEL_START,		// first label of each variable [N+2]
+		SECTION_LABELS,				// labels of the values (string offsets) [labels]
+		SECTION_FEATURE_NAME,		// name of each feature (string offset) [features]
+		SECTION_FEATURE_VAR,		// variable of each feature [features]
+		SECTION_FEATURE_VALUE_START,// first selecting value of each feature [features+1]
+		SECTION_FEATURE_VALUES,		// selecting values [featureValues]
+		SECTION_FEATURE_PARENT,		// parent of each feature, or FLAT_NO_PARENT [features]
+		SECTION_FEATURE_FLAGS,		// FLAT_FEATURE_* flags of each feature [features]
+		SECTION_OTHER_FEATURES,		// names of the features without a variable (string offsets) [otherFeatures]
+		SECTION_STRINGS,			// null-terminated strings [stringsSize bytes]
+		SECTION_COUNT
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t nVariables;
+		uint32_t nNodes;
+		uint32_t root;
+		uint32_t nFeatures;
+		uint32_t nOtherFeatures;
+		uint64_t nChildren;
+		uint64_t nLabels;
+		uint64_t nFeatureValues;
+		uint64_t stringsSize;
+		uint64_t offsets[SECTION_COUNT];
+	};
+
+	~FlatMdd();
+
+	static FlatMdd* fromEdge(const dd_edge &root, FeatureVisitor &v);
+	static FlatMdd* open(const string &fileName);
+	static FlatMdd* fromSections(uint32_t root,
+			const vector<uint32_t> *const sections[SECTION_COUNT - 1],
+			const string &strings);
+	void write(const string &fileName) const;
+
+	uint32_t getNumVariables() const {
+		return header->nVariables;
+	}
+	// Number of nodes, terminals included
+	uint32_t getNumNodes() const {
+		return header->nNodes;
+	}
+	uint32_t getRoot() const {
+		return header->root;
+	}
+	uint32_t getLevelStart(uint32_t level) const {
+		return section(SECTION_LEVEL_START)[level];
+	}
+	uint32_t getVariableAtLevel(uint32_t level) const {
+		return section(SECTION_LEVEL_VAR)[level];
+	}
+	uint32_t getLevelOfVariable(uint32_t variable) const {
+		return section(SECTION_VAR_LEVEL)[variable];
+	}
+	uint32_t getBound(uint32_t variable) const {
+		return section(SECTION_VAR_BOUND)[variable];
+	}
+	const uint32_t* getChildren(uint32_t node) const {
+		return section(SECTION_CHILDREN) + section(SECTION_CHILD_START)[node];
+	}
+	uint32_t getNumChildren(uint32_t node) const {
+		const uint32_t *start = section(SECTION_CHILD_START);
+		return start[node + 1] - start[node];
+	}
+	uint32_t getLevel(uint32_t node) const;
+	const char* getVariableName(uint32_t variable) const;
+	const char* getValueLabel(uint32_t variable, uint32_t value) const;
+	uint32_t getNumFeatures() const {
+		return header->nFeatures;
+	}
+	const char* getFeatureName(uint32_t feature) const;
+	uint32_t getFeatureVariable(uint32_t feature) const {
+		return section(SECTION_FEATURE_VAR)[feature];
+	}
+	const uint32_t* getFeatureValues(uint32_t feature) const {
+		return section(SECTION_FEATURE_VALUES)
+				+ section(SECTION_FEATURE_VALUE_START)[feature];
+	}
+	uint32_t getNumFeatureValues(uint32_t feature) const {
+		const uint32_t *start = section(SECTION_FEATURE_VALUE_START);
+		return start[feature + 1] - start[feature];
+	}
+	// The parent of a feature in the tree, or FLAT_NO_PARENT if it is not a feature
+	// of the snapshot (e.g., the root or an abstract feature)
+	uint32_t getFeatureParent(uint32_t feature) const {
+		return section(SECTION_FEATURE_PARENT)[feature];
+	}
+	bool isFeatureOptional(uint32_t feature) const {
+		return section(SECTION_FEATURE_FLAGS)[feature] & FLAT_FEATURE_OPTIONAL;
+	}
+	// Whether the parent of a feature is the root of the tree (always selected)
+	bool isFeatureParentRoot(uint32_t feature) const {
+		return section(SECTION_FEATURE_FLAGS)[feature] & FLAT_FEATURE_PARENT_ROOT;
+	}
+	bool isFeatureAbstract(uint32_t feature) const {
+		return section(SECTION_FEATURE_FLAGS)[feature] & FLAT_FEATURE_ABSTRACT;
+	}
+	int findFeature(const string &name) const;
+	// Whether a feature of the model has no variable (its selection is not encoded)
+	bool isFeatureWithoutVariable(const string &name) const {
+		return otherFeatures.count(name) > 0;
+	}
+	bool encodeFeatures(const vector<string> &selected,
+			vector<uint32_t> &values) const;
+	vector<uint32_t> decodeFeatures(const vector<uint32_t> &values) const;
+
+private:
+	// Either the owned buffer or the mapped file
+	vector<char> buffer;
+	const char *data;
+	size_t size;
+	bool mapped;
+	const Header *header;
+	unordered_map<string, uint32_t> featureIndex;
+	unordered_set<string> otherFeatures;
+
+	FlatMdd();
+	void attach(const char *data, size_t size);
+	void validate() const;
+	const uint32_t* section(Section s) const {
+		return (const uint32_t*) (data + header->offsets[s]);
+	}
+};
+
+#endif /* INCLUDE_FLATMDD_HPP_ */
@@ -0,0 +1,37 @@
+/*
+ * FlatPairs.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATPAIRS_HPP_
+#define INCLUDE_FLATPAIRS_HPP_
+
+#include <gmpxx.h>
+#include <string>
+#include <vector>
+#include "FlatMdd.hpp"
+
+using namespace std;
+
+/**
+ * Number of products containing each pair of feature literals (t = 2 interactions).
+ *
+ * The counts are not computed pair by pair: a marginal pass restricted to the products
+ * with feature a selected gives the count of (a, b) for every b at once, and the other
+ * polarities follow by difference from the unrestricted marginals:
+ *
+ *   (a, !b) = count(a) - (a, b)
+ *   (!a, b) = count(b) - (a, b)
+ *   (!a, !b) = total - count(a) - count(b) + (a, b)
+ *
+ * so F features need F + 1 passes, fewer since core and dead features need none. The
+ * passes are independent and the threads take the features one at a time.
+ */
+class FlatPairs {
+public:
+	static uint64_t writeCsv(const FlatMdd &flat, unsigned int threads,
+			double rareRatio, const string &fileName);
+};
+
+#endif /* INCLUDE_FLATPAIRS_HPP_ */
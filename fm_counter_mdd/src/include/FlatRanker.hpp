@@ -0,0 +1,56 @@
+/*
+ * FlatRanker.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATRANKER_HPP_
+#define INCLUDE_FLATRANKER_HPP_
+
+#include <gmpxx.h>
+#include <string>
+#include <vector>
+#include "FlatMdd.hpp"
+
+using namespace std;
+
+/**
+ * Bijection between [0, count) and the products of a FlatMdd.
+ *
+ * The products are in lexicographic order of the values of the variables, from the
+ * top level to the bottom one (so the order depends on the variable order of the
+ * snapshot). The rank of a product is the number of products before it: walking
+ * from the root, each value smaller than that of the product adds the number of
+ * completions of the levels below through that value. A node of level l has
+ * count(n) completions of the levels 1..l, so a child of level lc reached from level
+ * l has count(child) times the sizes of the skipped levels lc+1..l-1; a skipped level
+ * is a node whose values all lead to the same child.
+ *
+ * Any range of ranks can be enumerated independently, e.g. by several processes.
+ */
+class FlatRanker {
+public:
+	FlatRanker(const FlatMdd &flat, unsigned int threads);
+
+	const mpz_class& getCount() const {
+		return total;
+	}
+	void unrank(const mpz_class &rank, vector<uint32_t> &values) const;
+	mpz_class rank(const vector<uint32_t> &values) const;
+	void completions(uint32_t level, uint32_t node, mpz_class &result) const;
+
+	static mpz_class parseRank(const string &text);
+	static uint64_t writeRange(const FlatMdd &flat, unsigned int threads,
+			const mpz_class &first, const mpz_class &last, const string &fileName);
+
+private:
+	const FlatMdd &flat;
+	// Number of completions of the levels 1..l of each node of level l
+	vector<mpz_class> counts;
+	// prefix[l] is the product of the bounds of the levels 1..l
+	vector<mpz_class> prefix;
+	vector<uint32_t> levelOf;
+	mpz_class total;
+};
+
+#endif /* INCLUDE_FLATRANKER_HPP_ */
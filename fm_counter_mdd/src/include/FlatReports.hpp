@@ -0,0 +1,50 @@
+/*
+ * FlatReports.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATREPORTS_HPP_
+#define INCLUDE_FLATREPORTS_HPP_
+
+#include <string>
+#include <vector>
+#include "FlatMdd.hpp"
+
+using namespace std;
+
+/**
+ * Analyses of the final MDD computed on its flat form (see FlatMdd), both after a
+ * build (the flat MDD is built in memory) and on a snapshot given with --countFlat.
+ * Each analysis is enabled by setting its output file.
+ */
+class FlatReports {
+public:
+	static bool isRequested();
+	static void checkFiles();
+	static void write(const FlatMdd &flat);
+
+	static unsigned int THREADS;
+	static string MARGINALS_FILE;
+	static string FEATURE_CLASSES_FILE;
+	static string PAIRS_FILE;
+	static double PAIRS_RARE_RATIO;
+	static string SIZES_FILE;
+	static long MIN_SIZE;
+	static long MAX_SIZE;
+	static string SAMPLES_FILE;
+	static uint64_t SAMPLE_COUNT;
+	static uint64_t SAMPLE_SEED;
+	static vector<vector<string>> RANK_QUERIES;
+	static vector<string> UNRANK_QUERIES;
+	static string RANGE_FILE;
+	static string RANGE_FIRST;
+	static string RANGE_LAST;
+	static string PRODUCTS_FILE;
+	static string PRODUCTS_CSV_FILE;
+	static bool PRODUCT_NAMES;
+	static string VALIDATE_FILE;
+	static string VALIDATE_REPORT_FILE;
+};
+
+#endif /* INCLUDE_FLATREPORTS_HPP_ */
@@ -0,0 +1,57 @@
+/*
+ * FlatSampler.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATSAMPLER_HPP_
+#define INCLUDE_FLATSAMPLER_HPP_
+
+#include <gmpxx.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <ostream>
+#include "FlatMdd.hpp"
+
+using namespace std;
+
+/**
+ * Uniform random products of a FlatMdd.
+ *
+ * A product is drawn with a walk from the root: at each node, the edge of value i is
+ * taken with probability count(child i) / (bound * count(node)) (see
+ * FlatCounter::countNodes), so that every product has the same probability, and the
+ * variables of skipped levels take a uniform random value. The counts of the children
+ * of each node are divided by their gcd and stored once, as cumulative 64-bit integers
+ * next to the children, so the walks only read shared arrays and draw an integer below
+ * the last one: the draws are exact. The few nodes whose counts still exceed 64 bits
+ * keep them in GMP and draw by rejection from the words of the generator.
+ *
+ * The samples are drawn in blocks, each one with its own generator seeded with the
+ * seed and the number of the block: the samples do not depend on the number of threads.
+ */
+class FlatSampler {
+public:
+	FlatSampler(const FlatMdd &flat, unsigned int threads);
+
+	bool isEmpty() const;
+	void sample(std::mt19937_64 &random, vector<uint32_t> &values) const;
+	void writeFeatures(const vector<uint32_t> &values, ostream &out) const;
+
+	static uint64_t writeSamples(const FlatMdd &flat, unsigned int threads,
+			uint64_t samples, uint64_t seed, const string &fileName);
+
+private:
+	const FlatMdd &flat;
+	// Cumulative reduced count of the children of each node, aligned with them
+	vector<uint64_t> cumulative;
+	// First cumulative count of each node in exactCumulative, or NO_EXACT
+	vector<uint64_t> exactFirst;
+	vector<mpz_class> exactCumulative;
+	vector<uint32_t> levelOf;
+	// Features selected by each value of each variable
+	vector<vector<vector<uint32_t>>> selectedBy;
+};
+
+#endif /* INCLUDE_FLATSAMPLER_HPP_ */
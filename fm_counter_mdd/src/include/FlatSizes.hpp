@@ -0,0 +1,45 @@
+/*
+ * FlatSizes.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATSIZES_HPP_
+#define INCLUDE_FLATSIZES_HPP_
+
+#include <gmpxx.h>
+#include <string>
+#include <vector>
+#include "FlatMdd.hpp"
+#include "FlatCounter.hpp"
+
+using namespace std;
+
+// A polynomial in x: the coefficient of x^k is the number of products of size k
+typedef vector<mpz_class> SizePolynomial;
+
+/**
+ * Number of products by number of selected concrete features (the size of the
+ * product).
+ *
+ * Each value of a variable selects a number of concrete features, more than one for
+ * the values of merged variables, so a variable is the polynomial with a term x^w for
+ * each value selecting w features. The polynomial of a node is the sum, over its
+ * edges, of x^w times the polynomial of the child, times the polynomials of the
+ * variables of the skipped levels; that of the root, times those of the levels above
+ * it, has the number of products of size k as the coefficient of x^k.
+ *
+ * Features that are not in the snapshot (e.g., those not encoded by a variable) and
+ * abstract features are not counted.
+ */
+class FlatSizes {
+public:
+	static mpz_class countBySize(const FlatMdd &flat, unsigned int threads,
+			const ValueMask &mask, SizePolynomial &bySize);
+	static mpz_class countInRange(const SizePolynomial &bySize, long minSize,
+			long maxSize);
+	static void writeCsv(const FlatMdd &flat, unsigned int threads,
+			const string &fileName);
+};
+
+#endif /* INCLUDE_FLATSIZES_HPP_ */
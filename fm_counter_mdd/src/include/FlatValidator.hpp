@@ -0,0 +1,80 @@
+/*
+ * FlatValidator.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_FLATVALIDATOR_HPP_
+#define INCLUDE_FLATVALIDATOR_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include "FlatMdd.hpp"
+
+using namespace std;
+
+/**
+ * Validation of complete configurations (the names of their selected features, the
+ * other features being deselected) against a FlatMdd.
+ *
+ * A configuration is encoded once as the value of each variable: the value selecting
+ * exactly its selected features among those of the variable. It is a product if the
+ * path of these values from the root reaches the terminal true, with one child lookup
+ * per node; several configurations are walked together, one step each in turn, so that
+ * the lookups of different paths overlap. When the path reaches the terminal false,
+ * the level of the last node is the first violated level.
+ *
+ * When several values of a variable select the same features, all of them are
+ * candidates: from the first node of such a variable, the rest of the path is searched
+ * among the candidate values. The features of the model without a variable (see
+ * FlatMdd::isFeatureWithoutVariable) are ignored.
+ */
+class FlatValidator {
+public:
+	// Results of the validation of a configuration
+	enum Outcome {
+		VALID,
+		EXCLUDED,		// the path reaches the terminal false
+		INCONSISTENT,	// no value of a variable selects exactly its selected features
+		UNKNOWN_FEATURE	// a feature is not in the model
+	};
+
+	struct Result {
+		Outcome outcome;
+		// The violated level (EXCLUDED) or the level of the variable (INCONSISTENT)
+		uint32_t level;
+		// The unknown feature (UNKNOWN_FEATURE)
+		string feature;
+	};
+
+	FlatValidator(const FlatMdd &flat);
+
+	Result validate(const vector<string> &selected) const;
+	Result encode(const vector<string> &selected, uint32_t *values) const;
+	void evaluate(const uint32_t *values, size_t count, Result *results) const;
+
+	static vector<string> parseRow(const string &line);
+	static pair<uint64_t, uint64_t> writeReport(const FlatMdd &flat,
+			unsigned int threads, const string &inputFileName,
+			const string &reportFileName);
+
+private:
+	const FlatMdd &flat;
+	vector<uint32_t> levelOf;
+	// For each variable, the value selecting each set of features (sorted ids), or
+	// SEVERAL_VALUES and the index of its candidates
+	vector<map<vector<uint32_t>, uint32_t>> valueOf;
+	vector<vector<uint32_t>> candidates;
+	// The same for the most frequent sets: no feature (by variable) and a single
+	// feature (by feature), or NO_VALUE
+	vector<uint32_t> emptyValue;
+	vector<uint32_t> singleValue;
+
+	bool search(uint32_t node, const uint32_t *values,
+			unordered_map<uint32_t, uint32_t> &failed, uint32_t &level) const;
+};
+
+#endif /* INCLUDE_FLATVALIDATOR_HPP_ */
@@ -0,0 +1,38 @@
+/*
+ * Heartbeat.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_HEARTBEAT_HPP_
+#define INCLUDE_HEARTBEAT_HPP_
+
+#include <meddly.h>
+#include <string>
+
+using namespace std;
+using namespace MEDDLY;
+
+/**
+ * Background thread writing, every N seconds, a one-line status of the build (phase,
+ * cross-tree constraints applied/total, current nodes/edges, peak nodes, RSS, elapsed
+ * time and an estimate of the remaining time of the cross-tree phase).
+ *
+ * The pipeline publishes its progress through the static setters, which only store
+ * the values (atomically), so they can be called at every step.
+ */
+class Heartbeat {
+public:
+	static void start(double interval, const string &fileName);
+	static void stop();
+	static bool isEnabled();
+	static string setPhase(const string &name);
+	static void startConstraints(unsigned long first, unsigned long total);
+	static void setConstraints(unsigned long applied, unsigned long total);
+	static void setForest(unsigned long nodes, unsigned long edges,
+			long peakNodes);
+	static void update(const dd_edge &edge);
+	static string statusLine();
+};
+
+#endif /* INCLUDE_HEARTBEAT_HPP_ */
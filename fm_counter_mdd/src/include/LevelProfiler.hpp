@@ -0,0 +1,44 @@
+/*
+ * LevelProfiler.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_LEVELPROFILER_HPP_
+#define INCLUDE_LEVELPROFILER_HPP_
+
+#include <meddly.h>
+#include <meddly_expert.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include "NodeFeatureVisitor.h"
+
+using namespace std;
+using namespace MEDDLY;
+
+/**
+ * Records the number of nodes at each level of an intermediate MDD at given checkpoints
+ * (after each phase, every EVERY_K cross-tree constraints, before and after each reordering).
+ *
+ * Rows are written in long format (checkpoint;label;step;level;variable;feature;nodes), so that
+ * they can be pivoted into a checkpoint x level heatmap.
+ */
+class LevelProfiler {
+private:
+	static ofstream output;
+	static int checkpoints;
+
+public:
+	static void open(const string &fileName);
+	static void close();
+	static bool isEnabled();
+	static bool isStep(int appliedConstraints);
+	static void checkpoint(const string &label, int step, const dd_edge &e,
+			const FeatureVisitor &v);
+	static vector<unsigned long> countNodesPerLevel(const dd_edge &e);
+
+	static int EVERY_K;
+};
+
+#endif /* INCLUDE_LEVELPROFILER_HPP_ */
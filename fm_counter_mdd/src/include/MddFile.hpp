@@ -0,0 +1,44 @@
+/*
+ * MddFile.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_MDDFILE_HPP_
+#define INCLUDE_MDDFILE_HPP_
+
+#include <meddly.h>
+#include <string>
+#include <vector>
+#include "NodeFeatureVisitor.h"
+
+using namespace std;
+using namespace MEDDLY;
+
+/**
+ * Binary file containing a compiled feature model: the final MDD, the bounds and the
+ * order of the variables and the name/value tables of the FeatureVisitor, so that the
+ * model can be queried again without the XML.
+ *
+ * Layout (native byte order, integers are 32 bits):
+ *
+ *   "FMMDD" version N bounds[N] variableAtLevel[1..N]
+ *   variables: count, then (name, index, count, values...) for each variable
+ *   substitutions: count, then (feature, replacement)
+ *   andLeafs: count, then (feature, parent, count, values...)
+ *   featureTree: count, then (feature, parent, flags: 1 optional, 2 abstract)
+ *   nodes: count, then (variable, size, children[size]) bottom-up
+ *   root
+ *
+ * Strings are written as length and characters. Children and root are references:
+ * 0 is the terminal false, 1 the terminal true and k+2 the k-th node of the file,
+ * which always precedes the nodes referring to it.
+ */
+class MddFile {
+public:
+	static void save(const string &fileName, const dd_edge &root,
+			FeatureVisitor &v);
+	static dd_edge load(const string &fileName, FeatureVisitor &v);
+};
+
+#endif /* INCLUDE_MDDFILE_HPP_ */
@@ -0,0 +1,100 @@
+/*
+ * Metrics.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_METRICS_HPP_
+#define INCLUDE_METRICS_HPP_
+
+#include <meddly.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <iostream>
+#include "PerfCounters.hpp"
+
+using namespace std;
+using namespace MEDDLY;
+
+// Names of the phases of the pipeline, in the order used for the CSV columns
+#define PHASE_READ "read"
+#define PHASE_PARSE "parse"
+#define PHASE_VISIT "visitor"
+#define PHASE_FOREST "forest"
+#define PHASE_MANDATORY "mandatory"
+#define PHASE_MANDATORY_NON_LEAF "mandatoryNonLeaf"
+#define PHASE_OR "orGroups"
+#define PHASE_ALT "altGroups"
+#define PHASE_IMPLICATIONS "implications"
+#define PHASE_CTC_COMPILE "ctcCompile"
+#define PHASE_CTC_APPLY "ctcApply"
+#define PHASE_REORDER "reorder"
+#define PHASE_COUNT "count"
+// Loading of a checkpoint (see Checkpoint), not written in the CSV columns
+#define PHASE_RESUME "resume"
+
+/**
+ * Collects the metrics of a single run: wall and CPU time of each phase,
+ * peak resident memory and the statistics of the MEDDLY forest.
+ *
+ * Phases with the same name are accumulated (e.g., every reordering is added to
+ * PHASE_REORDER). Phases may be nested: PHASE_REORDER is also part of PHASE_CTC_APPLY.
+ */
+class Metrics {
+public:
+	struct Phase {
+		string name;
+		double wall;
+		double cpu;
+		unsigned long calls;
+		// Hardware counters (-1 if not available), see PerfCounters
+		long long counters[PERF_NUM_COUNTERS];
+	};
+
+	/**
+	 * Scoped timer: the phase starts when the object is created and ends when
+	 * it goes out of scope
+	 */
+	class PhaseTimer {
+	private:
+		string name;
+		double wallStart;
+		double cpuStart;
+		double traceStart;
+		long long perfStart[PERF_NUM_COUNTERS];
+		int allocPrevious;
+		string heartbeatPrevious;
+	public:
+		PhaseTimer(const string &name);
+		~PhaseTimer();
+	};
+
+	static void addPhase(const string &name, double wall, double cpu,
+			const long long *counters);
+	static void collectForestStats(forest *mdd);
+	static void setValue(const string &key, const string &value);
+	static void setValue(const string &key, double value);
+	static double wallTime();
+	static double cpuTime();
+	static long getPeakRSS();
+	static void writeJson(std::ostream &out);
+	static void writeCsvColumns(std::ostream &out);
+	static void writePerfCsvColumns(std::ostream &out);
+	static void reset();
+	static string jsonEscape(const string &text);
+
+	static bool ENABLED;
+
+private:
+	static vector<Phase> phases;
+	static map<string, string> values;
+	// Keys of the values set as numbers, written unquoted in the JSON report
+	static set<string> numericValues;
+	static const vector<string> CSV_PHASES;
+	static Phase* findPhase(const string &name);
+	static void writePerfRatios(std::ostream &out, const Phase &p, bool json);
+};
+
+#endif /* INCLUDE_METRICS_HPP_ */
@@ -3,6 +3,7 @@
 
 #include "rapidxml.hpp"
 #include <map>
+#include <set>
 #include <vector>
 #include <utility>
 #include <iostream>
@@ -27,6 +28,10 @@ private:
 	vector<pair<pair<int, int>, pair<int, int>>> singleImplicationsNonLeaf;
 	map<string, string> substitutions;
 	map<string, pair<string, vector<string>>> andLeafs;
+	// Parent of each feature of the tree and whether it is optional
+	map<string, pair<string, bool>> featureTree;
+	// Abstract features of the tree
+	set<string> abstractFeatures;
 
 	bool ignoreHidden;
 
@@ -69,10 +74,18 @@ public:
 	int getIndexOfNoneForVariable(const std::string &variableName);
 	int getIndexOfNoneForVariable(const int &variableIndex);
 	string getValueForVar(int indexVar, int indexVal);
+	string getNameForVar(int indexVar) const;
+	pair<int, vector<int>> getSelectingValues(const string &featureName);
+	vector<string> getFeatureNames();
+	void readFeatureTree(xml_node<> *node);
+	string getFeatureParent(const string &featureName) const;
+	bool isOptionalFeature(const string &featureName) const;
+	bool isAbstractFeature(const string &featureName) const;
 
 	virtual ~FeatureVisitor();
 
 	friend class ConstraintVisitor;
+	friend class MddFile;
 };
 
 #endif
@@ -0,0 +1,46 @@
+/*
+ * PerfCounters.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_PERFCOUNTERS_HPP_
+#define INCLUDE_PERFCOUNTERS_HPP_
+
+#include <string>
+
+using namespace std;
+
+// Indexes of the hardware counters
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_LLC_MISSES 2
+#define PERF_DTLB_MISSES 3
+#define PERF_NUM_COUNTERS 4
+
+/**
+ * Hardware performance counters of the process, read through perf_event_open.
+ *
+ * If the counters cannot be opened (e.g., kernel.perf_event_paranoid is too high, or the
+ * machine is virtualised), the unavailable counters read as -1 and the rest of the
+ * program is not affected.
+ */
+class PerfCounters {
+private:
+	static int fds[PERF_NUM_COUNTERS];
+	static bool opened;
+
+public:
+	static const char *NAMES[PERF_NUM_COUNTERS];
+
+	static bool open();
+	static void close();
+	static bool isEnabled();
+	static void read(long long values[PERF_NUM_COUNTERS]);
+	static double ratio(long long numerator, long long denominator,
+			double scale);
+
+	static bool REQUESTED;
+};
+
+#endif /* INCLUDE_PERFCOUNTERS_HPP_ */
@@ -0,0 +1,95 @@
+/*
+ * QueryServer.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_QUERYSERVER_HPP_
+#define INCLUDE_QUERYSERVER_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <sys/un.h>
+#include "FlatMdd.hpp"
+#include "FlatCounter.hpp"
+#include "FlatValidator.hpp"
+
+using namespace std;
+
+/**
+ * Daemon answering queries on compiled models over a Unix domain socket.
+ *
+ * The models are flat snapshots (see FlatMdd) loaded once and never modified, so the
+ * worker threads share them without locks. A single thread waits (poll) for requests
+ * on all the connections and queues them, the workers answer them: an idle client
+ * holds no thread. The requests are lines of whitespace-separated words and each one
+ * gets a single line as answer, starting with "ok" or "error"; the requests of a
+ * connection are answered one at a time, in order:
+ *
+ *   models                                  ok <name>...
+ *   count <model> [literal...]              ok <products>
+ *   validate <model> [feature...]           ok valid|invalid
+ *   marginal <model> <feature> [literal...] ok <selected> <products> <ratio>
+ *   quit                                    (closes the connection)
+ *   shutdown                                ok (stops the server, see ALLOW_SHUTDOWN)
+ *
+ * A literal is a feature name, or a name preceded by ! for a deselected feature.
+ * validate checks a complete configuration: the given features are selected and all
+ * the others are deselected (see FlatValidator).
+ */
+class QueryServer {
+public:
+	QueryServer();
+	~QueryServer();
+
+	void addModel(const string &name, const string &fileName);
+	void run(const string &socketPath, unsigned int threads);
+	void stop();
+	string answer(const string &request);
+
+	// Whether shutdown is accepted (only from clients running as the user of the server)
+	static bool ALLOW_SHUTDOWN;
+
+private:
+	struct Connection {
+		// Received bytes not yet taken as requests
+		string pending;
+		// A request of the connection is being answered: it is not read meanwhile
+		bool busy;
+	};
+	struct Request {
+		int fd;
+		string text;
+	};
+
+	map<string, FlatMdd*> models;
+	map<string, FlatValidator*> validators;
+	int listener;
+	// Pipe waking up the poll loop when a worker has answered a request
+	int wakeup[2];
+	std::atomic<bool> stopping;
+	// Connections and queued requests, shared by the poll loop and the workers
+	map<int, Connection> connections;
+	deque<Request> queue;
+	std::mutex lock;
+	std::condition_variable queued;
+
+	void pollRequests();
+	void work();
+	void wake();
+	void acceptConnections();
+	void readConnection(int fd);
+	void closeConnection(int fd);
+	void dispatch();
+	bool maySendShutdown(int fd) const;
+	static void removeStaleSocket(const sockaddr_un &address);
+	const FlatMdd& getModel(const string &name) const;
+};
+
+#endif /* INCLUDE_QUERYSERVER_HPP_ */
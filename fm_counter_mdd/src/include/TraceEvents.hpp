@@ -0,0 +1,59 @@
+/*
+ * TraceEvents.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef INCLUDE_TRACEEVENTS_HPP_
+#define INCLUDE_TRACEEVENTS_HPP_
+
+#include <meddly.h>
+#include <string>
+#include <fstream>
+
+using namespace std;
+using namespace MEDDLY;
+
+/**
+ * Writer of a trace-event JSON file (the format read by chrome://tracing and Perfetto).
+ *
+ * Events are appended to the file as soon as they complete, so that a trace of a run
+ * killed by a timeout can still be loaded.
+ */
+class TraceEvents {
+private:
+	static ofstream output;
+	static double origin;
+	static bool first;
+
+	static void writeEventHeader(const string &name, const string &category,
+			char phase, double ts);
+
+public:
+	/**
+	 * Scoped span: a complete event ("X") is written when the object goes out of scope
+	 */
+	class Span {
+	private:
+		string name;
+		string category;
+		string args;
+		double start;
+	public:
+		Span(const string &name, const string &category);
+		~Span();
+		void setArg(const string &key, const string &value);
+	};
+
+	static void open(const string &fileName);
+	static void close();
+	static bool isEnabled();
+	static double now();
+	static void complete(const string &name, const string &category,
+			double start, double duration, const string &args);
+	static void counter(const string &name, double value);
+	static void forestCounters(forest *mdd);
+	static long getCurrentRSS();
+};
+
+#endif /* INCLUDE_TRACEEVENTS_HPP_ */
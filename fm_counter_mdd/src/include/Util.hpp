@@ -14,11 +14,23 @@
 #include "NodeFeatureVisitor.h"
 #include <fstream>
 #include "rapidxml.hpp"
+#include "Metrics.hpp"
+#include "LevelProfiler.hpp"
+#include "TraceEvents.hpp"
+#include "AllocTracker.hpp"
+#include "Heartbeat.hpp"
+#include "Budget.hpp"
+#include "Checkpoint.hpp"
+#include "MddFile.hpp"
+#include "FlatMdd.hpp"
+#include "FlatReports.hpp"
 
 using namespace rapidxml;
 using namespace MEDDLY;
 using namespace std;
 
+struct ConstraintInfo;
+
 class Util {
 private:
 	static dd_edge addMandatory(const dd_edge &emptyNode, const int N,
@@ -31,19 +43,46 @@ private:
 			FeatureVisitor &v, dd_edge &c, forest *mdd, dd_edge &startingNode);
 	static void addCrossTreeConstraints(const FeatureVisitor v,
 			const dd_edge emptyNode, dd_edge &startingNode,
-			xml_node<> *constraintNode, forest *mdd, int reduction_factor);
+			xml_node<> *constraintNode, forest *mdd, int reduction_factor,
+			const char *source);
+	static void addFeatureTreeConstraints(const int N, const dd_edge &emptyNode,
+			FeatureVisitor &v, forest *mdd, dd_edge &startingNode);
+	static void writeTraceRow(std::ostream &trace, int step, double elapsed,
+			const ConstraintInfo &info, unsigned long compiledNodes,
+			double applyTime, unsigned long nodesBefore,
+			unsigned long edgesBefore, unsigned long nodesAfter,
+			unsigned long edgesAfter, double reorderTime);
 	static void addAltGroupConstraints(FeatureVisitor v, const dd_edge emptyNode,
 			const int N, dd_edge &startingNode, forest *mdd);
+	static void checkBudget(const string &phase, const dd_edge &startingNode);
+	static void exportFlat(const dd_edge &root, FeatureVisitor &v);
+	static void keepFinalMdd(const dd_edge &root, const FeatureVisitor &v);
+
+	// The final MDD of the last count and its visitor, kept for writeAnalyses
+	static dd_edge *FINAL_ROOT;
+	static FeatureVisitor *FINAL_VISITOR;
 
 public:
 	static void printElements(std::ostream &strm, dd_edge &e);
 	static dd_edge getMDDFromTuple(vector<int> tupla, forest *mdd);
+	static forest* createForest(const int *bounds, const int N);
 	static string* parseXML(const string &fileName);
 	static void printVector(vector<int> v, ostream &out);
 	static string getProductCountFromFile(string fileName);
 	static string getProductCountFromFile(string fileName, bool ignore);
 	static string getProductCountFromFile(string fileName, bool ignore, int reduction_factor_ctc);
 	static string getProductCountFromFile(string fileName, int reduction_factor_ctc);
+	static string getProductCountFromMddFile(string fileName);
+	static string cardinality(const dd_edge &e);
+	static dd_edge restrictToLiterals(const dd_edge &root,
+			const vector<string> &literals, FeatureVisitor &v);
+	static vector<string> splitLiterals(const string &line);
+	static string joinLiterals(const vector<string> &literals);
+	static void readAssumptions(const string &fileName);
+	static void checkOutputFiles();
+	static void checkAssumptions(FeatureVisitor &v);
+	static void writeConditionalCounts(const dd_edge &root, FeatureVisitor &v);
+	static bool writeAnalyses();
 
 	static bool IGNORE_HIDDEN;
 	static bool SORT_CONSTRAINTS_WHEN_APPLYING;
@@ -52,6 +91,11 @@ public:
 	static bool REORDER_VARIABLES;
 	static double N_MAX_NODES;
 	static double N_MAX_EDGES;
+	static string CTC_TRACE_FILE;
+	static string SAVE_MDD_FILE;
+	static string FLAT_MDD_FILE;
+	// Sets of feature literals whose products are counted on the final MDD
+	static vector<vector<string>> ASSUMPTIONS;
 };
 
 #endif /* INCLUDE_UTIL_HPP_ */
@@ -7,6 +7,7 @@
 #ifndef LOGGER_HPP_
 #define LOGGER_HPP_
 #include <iostream>
+#include <string>
 
 // A class which does not print anything
 struct nullstream: std::ostream {
@@ -19,8 +20,34 @@ enum log_level_t {
 	LOG_NOTHING, LOG_CRITICAL, LOG_ERROR, LOG_WARNING, LOG_INFO, LOG_DEBUG
 };
 
+/**
+ * Highest level compiled into the binary. Statements above this level are removed
+ * by the compiler (see the log_level option in meson_options.txt).
+ */
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL LOG_DEBUG
+#endif
+
 extern log_level_t threshold;
 
+/**
+ * True if a statement at level x is both compiled in and enabled at runtime.
+ * The first operand is a constant, so disabled levels are folded away.
+ */
+#define LOG_ENABLED(x) ((x) <= LOG_MAX_LEVEL && (x) <= threshold)
+
+/**
+ * Logging statement: LOGCOUT(LOG_DEBUG) << a << b;
+ *
+ * When the level is disabled the right-hand side of << is never evaluated.
+ */
+#define LOGCOUT(x) if (!LOG_ENABLED(x)) ; else logcout(x)
+
 std::ostream& logcout(log_level_t x);
 
+log_level_t parseLogLevel(const std::string &name);
+
+void startAsyncLogging(const std::string &fileName, size_t capacity);
+void stopAsyncLogging();
+
 #endif /* LOGGER_HPP_ */
@@ -7,12 +7,196 @@
 
 #include "logger.hpp"
 #include <iostream>
+#include <fstream>
+#include <streambuf>
+#include <stdexcept>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 static nullstream lognullstream;
 
-log_level_t threshold = LOG_DEBUG;
+log_level_t threshold = LOG_INFO;
+
+/**
+ * Ring buffer of complete log lines, drained by a background thread.
+ *
+ * When the producer is faster than the sink, the oldest lines are overwritten
+ * and the number of lost lines is reported when logging is stopped.
+ */
+class ring_logbuf: public std::streambuf {
+private:
+	std::vector<std::string> slots;
+	size_t head = 0;
+	size_t count = 0;
+	unsigned long dropped = 0;
+	bool stopping = false;
+	std::ostream *sink;
+	std::ofstream file;
+	std::mutex lock;
+	std::condition_variable ready;
+	std::thread consumer;
+
+	/**
+	 * The line being composed by the calling thread. Every thread writes its own
+	 * partial line, so that statements logged concurrently are never interleaved.
+	 */
+	static std::string& pending() {
+		static thread_local std::string line;
+		return line;
+	}
+
+	void push(std::string &line) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (count == slots.size()) {
+				head = (head + 1) % slots.size();
+				count--;
+				dropped++;
+			}
+			slots[(head + count) % slots.size()].swap(line);
+			count++;
+		}
+		line.clear();
+		ready.notify_one();
+	}
+
+	void drain() {
+		std::string current;
+		std::unique_lock<std::mutex> guard(lock);
+		while (true) {
+			ready.wait(guard, [this] {
+				return count > 0 || stopping;
+			});
+			if (count == 0 && stopping)
+				break;
+			current.swap(slots[head]);
+			head = (head + 1) % slots.size();
+			count--;
+			// The line is written under the lock, so the sink is never used concurrently
+			*sink << current;
+			current.clear();
+		}
+		sink->flush();
+	}
+
+protected:
+	int_type overflow(int_type c) override {
+		if (c != traits_type::eof()) {
+			std::string &line = pending();
+			line.push_back(traits_type::to_char_type(c));
+			if (c == '\n')
+				push(line);
+		}
+		return c;
+	}
+
+	std::streamsize xsputn(const char *s, std::streamsize n) override {
+		std::string &line = pending();
+		for (std::streamsize i = 0; i < n; i++) {
+			line.push_back(s[i]);
+			if (s[i] == '\n')
+				push(line);
+		}
+		return n;
+	}
+
+	int sync() override {
+		std::string &line = pending();
+		if (!line.empty())
+			push(line);
+		return 0;
+	}
+
+public:
+	ring_logbuf(const std::string &fileName, size_t capacity) :
+			slots(capacity > 0 ? capacity : 1) {
+		if (fileName.empty()) {
+			sink = &std::cout;
+		} else {
+			file.open(fileName, std::ios::out | std::ios::app);
+			if (!file.is_open())
+				throw std::invalid_argument("Cannot open log file " + fileName);
+			sink = &file;
+		}
+		consumer = std::thread(&ring_logbuf::drain, this);
+	}
+
+	~ring_logbuf() {
+		sync();
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		ready.notify_one();
+		consumer.join();
+		if (dropped > 0)
+			std::cerr << "Async logger dropped " << dropped << " lines" << std::endl;
+	}
+};
+
+static ring_logbuf *asyncBuffer = nullptr;
+
+/**
+ * The stream of the calling thread on the ring buffer: the state of a std::ostream
+ * (width, flags) is modified by every insertion, so threads do not share one
+ */
+static std::ostream& asyncStream() {
+	static thread_local std::ostream stream(nullptr);
+	if (stream.rdbuf() != asyncBuffer)
+		stream.rdbuf(asyncBuffer);
+	return stream;
+}
 
 std::ostream& logcout(log_level_t x) {
-	return ((x <= threshold) ? std::cout : lognullstream);
+	if (x > threshold)
+		return lognullstream;
+	return (asyncBuffer != nullptr) ? asyncStream() : std::cout;
+}
+
+/**
+ * Converts the name of a level (e.g., "debug", "info") into the corresponding log_level_t
+ *
+ * @param name the name of the level
+ * @return the corresponding level
+ */
+log_level_t parseLogLevel(const std::string &name) {
+	if (name == "nothing" || name == "none")
+		return LOG_NOTHING;
+	if (name == "critical")
+		return LOG_CRITICAL;
+	if (name == "error")
+		return LOG_ERROR;
+	if (name == "warning")
+		return LOG_WARNING;
+	if (name == "info")
+		return LOG_INFO;
+	if (name == "debug")
+		return LOG_DEBUG;
+	throw std::invalid_argument("Invalid log level: " + name);
+}
+
+/**
+ * Redirects the logger to an asynchronous ring-buffer sink. Lines are written by a
+ * background thread, so that tracing at LOG_DEBUG does not stall the MDD construction.
+ *
+ * @param fileName the file to which the lines are appended (stdout if empty)
+ * @param capacity the number of lines kept in the ring buffer
+ */
+void startAsyncLogging(const std::string &fileName, size_t capacity) {
+	stopAsyncLogging();
+	asyncBuffer = new ring_logbuf(fileName, capacity);
+}
+
+/**
+ * Flushes the pending lines and goes back to synchronous logging on stdout
+ */
+void stopAsyncLogging() {
+	if (asyncBuffer == nullptr)
+		return;
+	asyncStream().flush();
+	delete asyncBuffer;
+	asyncBuffer = nullptr;
 }
@@ -0,0 +1,61 @@
+/*
+ * FlatCounterTest.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <catch2/catch.hpp>
+#include <stdexcept>
+#include "FlatFixture.hpp"
+#include "FlatCounter.hpp"
+
+TEST_CASE("Every number type gives the same count", "[FlatCounter]") {
+	const FlatMdd &flat = carModel();
+	const string exact = to_string(CAR_PRODUCTS);
+	for (unsigned int threads : { 1, 3 }) {
+		CHECK(FlatCounter::count(flat, threads, "exact") == exact);
+		CHECK(FlatCounter::count(flat, threads, "mpz") == exact);
+		CHECK(FlatCounter::count(flat, threads, "int128") == exact);
+		CHECK(FlatCounter::count(flat, threads, "double") == exact);
+		CHECK(FlatCounter::count(flat, threads, "mod64") == exact + " (mod 2^64)");
+		CHECK(stod(FlatCounter::count(flat, threads, "log"))
+				== Approx(CAR_PRODUCTS).epsilon(1e-5));
+	}
+	CHECK_THROWS_AS(FlatCounter::count(flat, 1, "float"), std::invalid_argument);
+}
+
+TEST_CASE("Assumptions restrict the count", "[FlatCounter]") {
+	const FlatMdd &flat = carModel();
+	// Electric excludes the towbar: 1 engine, 8 comfort options, sunroof only with
+	// air conditioning (12 of 16)
+	vector<ValueMask> masks(3);
+	FlatCounter::assume(flat, "Electric", masks[0]);
+	FlatCounter::assume(flat, "!Electric", masks[1]);
+	FlatCounter::assume(flat, "Electric", masks[2]);
+	FlatCounter::assume(flat, "Towbar", masks[2]);
+	for (const string &type : { "exact", "mpz", "int128", "double" }) {
+		CHECK(FlatCounter::count(flat, 2, type, masks[0]) == "12");
+		CHECK(FlatCounter::count(flat, 2, type, masks[1]) == "48");
+		CHECK(FlatCounter::count(flat, 2, type, masks[2]) == "0");
+	}
+	CHECK(FlatCounter::countBatch(flat, 2, masks)
+			== vector<string>( { "12", "48", "0" }));
+}
+
+TEST_CASE("Counts above 128 bits are promoted to GMP", "[FlatCounter]") {
+	const FlatMdd &flat = wideModel();
+	vector<ValueMask> masks(3);
+	FlatCounter::assume(flat, "f" + to_string(WIDE_VARIABLES), masks[1]);
+	FlatCounter::assume(flat, "!f1", masks[2]);
+	FlatCounter::assume(flat, "f2", masks[2]);
+	for (unsigned int threads : { 1, 3 }) {
+		const string exact = FlatCounter::count(flat, threads, "exact");
+		CHECK(mpz_class(exact) > mpz_class(1) << 128);
+		CHECK(exact == FlatCounter::count(flat, threads, "mpz"));
+		CHECK_THROWS_AS(FlatCounter::count(flat, threads, "int128"),
+				std::overflow_error);
+		vector<string> batch = FlatCounter::countBatch(flat, threads, masks);
+		for (size_t k = 0; k < masks.size(); k++)
+			CHECK(batch[k] == FlatCounter::count(flat, threads, "mpz", masks[k]));
+	}
+}
@@ -0,0 +1,79 @@
+/*
+ * FlatEnumeratorTest.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <catch2/catch.hpp>
+#include <fstream>
+#include <set>
+#include "FlatFixture.hpp"
+#include "FlatEnumerator.hpp"
+#include "FlatRanker.hpp"
+
+/**
+ * Splits a line of the decoded CSV file
+ */
+static vector<string> splitFields(const string &line) {
+	vector<string> fields;
+	for (size_t start = 0; start < line.size();) {
+		size_t end = line.find(';', start);
+		if (end == string::npos)
+			end = line.size();
+		fields.push_back(line.substr(start, end - start));
+		start = end + 1;
+	}
+	return fields;
+}
+
+TEST_CASE("Every product is enumerated once", "[FlatEnumerator]") {
+	const FlatMdd &flat = carModel();
+	const uint32_t N = flat.getNumVariables();
+	FlatRanker ranker(flat, 1);
+	const string binary = testFile("products.bin");
+	const string csv = testFile("products.csv");
+	CHECK(FlatEnumerator::writeBinary(flat, 3, binary) == CAR_PRODUCTS);
+
+	SECTION("the records decode to the values of distinct products") {
+		CHECK(FlatEnumerator::decodeCsv(flat, binary, csv, false) == CAR_PRODUCTS);
+		ifstream input(csv);
+		string line;
+		REQUIRE(getline(input, line));
+		CHECK(splitFields(line).size() == N);
+		set<mpz_class> ranks;
+		vector<uint32_t> values(N + 1, 0);
+		while (getline(input, line)) {
+			vector<string> fields = splitFields(line);
+			REQUIRE(fields.size() == N);
+			for (uint32_t var = 1; var <= N; var++)
+				values[var] = stoul(fields[var - 1]);
+			mpz_class rank = ranker.rank(values);
+			CHECK(rank >= 0);
+			ranks.insert(rank);
+		}
+		CHECK(ranks.size() == CAR_PRODUCTS);
+	}
+
+	SECTION("the records decode to the features of distinct products") {
+		CHECK(FlatEnumerator::decodeCsv(flat, binary, csv, true) == CAR_PRODUCTS);
+		ifstream input(csv);
+		string line;
+		set<mpz_class> ranks;
+		vector<uint32_t> values;
+		while (getline(input, line)) {
+			REQUIRE(flat.encodeFeatures(splitFields(line), values));
+			mpz_class rank = ranker.rank(values);
+			CHECK(rank >= 0);
+			ranks.insert(rank);
+		}
+		CHECK(ranks.size() == CAR_PRODUCTS);
+	}
+}
+
+TEST_CASE("Products files of another model are rejected", "[FlatEnumerator]") {
+	const string csv = testFile("products.csv");
+	ofstream(testFile("garbage.bin")) << "not a products file";
+	CHECK_THROWS_AS(
+			FlatEnumerator::decodeCsv(carModel(), testFile("garbage.bin"), csv,
+					false), std::invalid_argument);
+}
@@ -0,0 +1,130 @@
+/*
+ * FlatFixture.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include "FlatFixture.hpp"
+#include "FlatRanker.hpp"
+#include "Util.hpp"
+#include <filesystem>
+#include <stdexcept>
+
+/**
+ * The flat MDD of models/car.xml, built once with the options used by default by
+ * FMBuilderExperimenter and read back from its snapshot
+ */
+const FlatMdd& carModel() {
+	static FlatMdd *flat = NULL;
+	if (flat == NULL) {
+		const string snapshot = testFile("car.flat");
+		FeatureVisitor::COMPRESS_AND_VARS = false;
+		FeatureVisitor::COMPRESS_AND_THRESHOLD = 0;
+		Util::REORDER_VARIABLES = false;
+		Util::PRINT_MDD = false;
+		Util::FLAT_MDD_FILE = snapshot;
+		Util::getProductCountFromFile(string(TEST_MODELS_DIR) + "/car.xml", false,
+				1);
+		if (!Util::writeAnalyses())
+			throw std::runtime_error("Cannot export the car model");
+		Util::FLAT_MDD_FILE = "";
+		flat = FlatMdd::open(snapshot);
+	}
+	return *flat;
+}
+
+/**
+ * A synthetic flat MDD too large for 128-bit counts, with WIDE_VARIABLES boolean
+ * variables (variable l at level l) and the feature fl selected by the value 1 of each.
+ * The node F(l) of each level has F(l-1) as first child and, on odd levels, also as
+ * second child, so the count is above 2^(WIDE_VARIABLES/2). Otherwise the second child
+ * is one of two nodes of the level below whose children are pseudo-random lower nodes,
+ * so that many edges skip levels.
+ */
+const FlatMdd& wideModel() {
+	static FlatMdd *flat = NULL;
+	if (flat != NULL)
+		return *flat;
+	const uint32_t N = WIDE_VARIABLES;
+	string strings;
+	auto addString = [&strings](const string &s) -> uint32_t {
+		uint32_t offset = strings.size();
+		strings += s;
+		strings += '\0';
+		return offset;
+	};
+	vector<uint32_t> levelVar(N + 1, 0), varLevel(N + 1, 0), bound(N + 1, 0);
+	vector<uint32_t> levelStart(N + 2, 0), childStart(3, 0), children;
+	vector<uint32_t> varName(N + 1, addString("")), labelStart(N + 2, 0), labels;
+	vector<uint32_t> featureName, featureVar, featureValueStart, featureValues;
+	vector<uint32_t> featureParent, featureFlags, others;
+	uint32_t seed = 12345;
+	auto below = [&seed](uint32_t limit) {
+		seed = seed * 1103515245u + 12345u;
+		return (seed >> 8) % limit;
+	};
+	uint32_t full = FLAT_TRUE, next = 2;
+	levelStart[1] = 2;
+	for (uint32_t level = 1; level <= N; level++) {
+		levelVar[level] = varLevel[level] = level;
+		bound[level] = 2;
+		const uint32_t first = levelStart[level];
+		children.push_back(full);
+		children.push_back((level % 2 == 1) ? full : first - 1 - below(2));
+		childStart.push_back(children.size());
+		full = next++;
+		for (int r = 0; r < 2; r++) {
+			children.push_back(below(first));
+			children.push_back(below(first));
+			childStart.push_back(children.size());
+			next++;
+		}
+		levelStart[level + 1] = next;
+
+		varName[level] = addString("v" + to_string(level));
+		labelStart[level] = labels.size();
+		labels.push_back(addString("0"));
+		labels.push_back(addString("1"));
+		featureName.push_back(addString("f" + to_string(level)));
+		featureVar.push_back(level);
+		featureValueStart.push_back(featureValues.size());
+		featureValues.push_back(1);
+		featureParent.push_back(FLAT_NO_PARENT);
+		featureFlags.push_back(FLAT_FEATURE_OPTIONAL);
+	}
+	labelStart[N + 1] = labels.size();
+	featureValueStart.push_back(featureValues.size());
+	const vector<uint32_t> *sections[FlatMdd::SECTION_COUNT - 1] = { &levelVar,
+			&varLevel, &bound, &levelStart, &childStart, &children, &varName,
+			&labelStart, &labels, &featureName, &featureVar, &featureValueStart,
+			&featureValues, &featureParent, &featureFlags, &others };
+	flat = FlatMdd::fromSections(full, sections, strings);
+	return *flat;
+}
+
+/**
+ * The selected features of the first product of the car model with a feature
+ */
+vector<string> carProductWith(const string &feature) {
+	const FlatMdd &flat = carModel();
+	FlatRanker ranker(flat, 1);
+	vector<uint32_t> values;
+	for (mpz_class rank = 0; rank < ranker.getCount(); rank++) {
+		ranker.unrank(rank, values);
+		vector<string> names;
+		for (uint32_t f : flat.decodeFeatures(values))
+			names.push_back(flat.getFeatureName(f));
+		for (const string &name : names)
+			if (name == feature)
+				return names;
+	}
+	throw std::invalid_argument("No product with " + feature);
+}
+
+/**
+ * The path of a scratch file of the tests
+ */
+string testFile(const string &name) {
+	return (std::filesystem::temp_directory_path() / ("fm_counter_test_" + name))
+			.string();
+}
@@ -0,0 +1,31 @@
+/*
+ * FlatFixture.hpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#ifndef TEST_FLATFIXTURE_HPP_
+#define TEST_FLATFIXTURE_HPP_
+
+#include <string>
+#include <vector>
+#include "FlatMdd.hpp"
+
+using namespace std;
+
+/**
+ * Products of models/car.xml: 3 engines, no comfort or one of its 7 nonempty
+ * subsets, towbar and sunroof (96 configurations), minus the 16 with an electric
+ * engine and a towbar, minus the 20 others with a sunroof and no air conditioning
+ */
+const unsigned long CAR_PRODUCTS = 60;
+
+// Number of variables of the synthetic model: its count exceeds 2^(WIDE_VARIABLES/2)
+const uint32_t WIDE_VARIABLES = 300;
+
+const FlatMdd& carModel();
+const FlatMdd& wideModel();
+vector<string> carProductWith(const string &feature);
+string testFile(const string &name);
+
+#endif /* TEST_FLATFIXTURE_HPP_ */
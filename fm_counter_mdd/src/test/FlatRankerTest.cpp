@@ -0,0 +1,62 @@
+/*
+ * FlatRankerTest.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <catch2/catch.hpp>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include "FlatFixture.hpp"
+#include "FlatRanker.hpp"
+
+TEST_CASE("Ranking inverts unranking", "[FlatRanker]") {
+	const FlatMdd &flat = carModel();
+	FlatRanker ranker(flat, 2);
+	REQUIRE(ranker.getCount() == CAR_PRODUCTS);
+
+	set<vector<uint32_t>> products;
+	vector<uint32_t> values;
+	for (unsigned long rank = 0; rank < CAR_PRODUCTS; rank++) {
+		ranker.unrank(rank, values);
+		CHECK(ranker.rank(values) == rank);
+		products.insert(values);
+	}
+	// Distinct ranks give distinct products, so every product has a rank
+	CHECK(products.size() == CAR_PRODUCTS);
+	CHECK_THROWS_AS(ranker.unrank(CAR_PRODUCTS, values), std::out_of_range);
+}
+
+TEST_CASE("Configurations that are not products have no rank", "[FlatRanker]") {
+	const FlatMdd &flat = carModel();
+	FlatRanker ranker(flat, 1);
+	vector<string> selected = carProductWith("Electric");
+	selected.push_back("Towbar");
+	vector<uint32_t> values;
+	REQUIRE(flat.encodeFeatures(selected, values));
+	CHECK(ranker.rank(values) == -1);
+}
+
+TEST_CASE("Ranges list the products in rank order", "[FlatRanker]") {
+	const FlatMdd &flat = carModel();
+	FlatRanker ranker(flat, 1);
+	const string range = testFile("range.txt");
+	CHECK(FlatRanker::writeRange(flat, 2, 10, 1000, range)
+			== CAR_PRODUCTS - 10);
+	ifstream input(range);
+	string line;
+	vector<uint32_t> values;
+	for (unsigned long rank = 10; getline(input, line); rank++) {
+		vector<string> selected;
+		for (size_t start = 0; start < line.size();) {
+			size_t end = line.find(';', start);
+			if (end == string::npos)
+				end = line.size();
+			selected.push_back(line.substr(start, end - start));
+			start = end + 1;
+		}
+		REQUIRE(flat.encodeFeatures(selected, values));
+		CHECK(ranker.rank(values) == rank);
+	}
+}
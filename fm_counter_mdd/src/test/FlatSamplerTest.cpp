@@ -0,0 +1,79 @@
+/*
+ * FlatSamplerTest.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <catch2/catch.hpp>
+#include "FlatFixture.hpp"
+#include "FlatSampler.hpp"
+#include "FlatRanker.hpp"
+#include <fstream>
+
+TEST_CASE("Samples are products drawn uniformly", "[FlatSampler]") {
+	const FlatMdd &flat = carModel();
+	FlatSampler sampler(flat, 2);
+	FlatRanker ranker(flat, 1);
+	REQUIRE(!sampler.isEmpty());
+	REQUIRE(ranker.getCount() == CAR_PRODUCTS);
+
+	const uint64_t perProduct = 1000;
+	std::mt19937_64 random(7);
+	vector<uint64_t> hits(CAR_PRODUCTS, 0);
+	uint64_t invalid = 0;
+	vector<uint32_t> values;
+	for (uint64_t k = 0; k < perProduct * CAR_PRODUCTS; k++) {
+		sampler.sample(random, values);
+		mpz_class rank = ranker.rank(values);
+		if (rank < 0)
+			invalid++;
+		else
+			hits[rank.get_ui()]++;
+	}
+	CHECK(invalid == 0);
+	// The hits of each product are binomial, with a standard deviation close to 31
+	for (uint64_t h : hits) {
+		CHECK(h > perProduct - 160);
+		CHECK(h < perProduct + 160);
+	}
+}
+
+TEST_CASE("Samples do not depend on the number of threads", "[FlatSampler]") {
+	const FlatMdd &flat = carModel();
+	const string one = testFile("samples1.txt");
+	const string four = testFile("samples4.txt");
+	CHECK(FlatSampler::writeSamples(flat, 1, 500, 3, one) == 500);
+	CHECK(FlatSampler::writeSamples(flat, 4, 500, 3, four) == 500);
+	ifstream first(one), second(four);
+	string a, b;
+	while (getline(first, a)) {
+		REQUIRE(getline(second, b));
+		CHECK(a == b);
+	}
+	CHECK(!getline(second, b));
+}
+
+TEST_CASE("Samples are uniform above 64 bits", "[FlatSampler]") {
+	const FlatMdd &flat = wideModel();
+	FlatSampler sampler(flat, 2);
+	FlatRanker ranker(flat, 1);
+	const mpz_class count = ranker.getCount();
+	REQUIRE(count > (mpz_class(1) << 128));
+
+	// The ranks of the samples fall in each quarter with probability 1/4
+	const uint64_t perQuarter = 1000;
+	std::mt19937_64 random(11);
+	vector<uint64_t> hits(4, 0);
+	vector<uint32_t> values;
+	for (uint64_t k = 0; k < 4 * perQuarter; k++) {
+		sampler.sample(random, values);
+		mpz_class rank = ranker.rank(values);
+		REQUIRE(rank >= 0);
+		hits[mpz_class(4 * rank / count).get_ui()]++;
+	}
+	// The hits of each quarter are binomial, with a standard deviation close to 27
+	for (uint64_t h : hits) {
+		CHECK(h > perQuarter - 140);
+		CHECK(h < perQuarter + 140);
+	}
+}
@@ -0,0 +1,114 @@
+/*
+ * FlatValidatorTest.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#include <catch2/catch.hpp>
+#include <fstream>
+#include "FlatFixture.hpp"
+#include "FlatValidator.hpp"
+#include "FlatRanker.hpp"
+
+/**
+ * The selected features of every product of the car model
+ */
+static vector<vector<string>> carProducts() {
+	const FlatMdd &flat = carModel();
+	FlatRanker ranker(flat, 1);
+	vector<vector<string>> products;
+	vector<uint32_t> values;
+	for (unsigned long rank = 0; rank < CAR_PRODUCTS; rank++) {
+		ranker.unrank(rank, values);
+		vector<string> names;
+		for (uint32_t f : flat.decodeFeatures(values))
+			names.push_back(flat.getFeatureName(f));
+		products.push_back(names);
+	}
+	return products;
+}
+
+TEST_CASE("Products are valid", "[FlatValidator]") {
+	FlatValidator validator(carModel());
+	for (const vector<string> &product : carProducts())
+		CHECK(validator.validate(product).outcome == FlatValidator::VALID);
+}
+
+TEST_CASE("Invalid configurations are told apart", "[FlatValidator]") {
+	const FlatMdd &flat = carModel();
+	FlatValidator validator(flat);
+
+	SECTION("a constraint excludes the configuration") {
+		vector<string> selected = carProductWith("Electric");
+		selected.push_back("Towbar");
+		FlatValidator::Result result = validator.validate(selected);
+		CHECK(result.outcome == FlatValidator::EXCLUDED);
+		CHECK(result.level >= 1);
+		CHECK(result.level <= flat.getNumVariables());
+	}
+
+	SECTION("no value encodes the features of a variable") {
+		vector<string> selected = carProductWith("Petrol");
+		selected.push_back("Diesel");
+		FlatValidator::Result result = validator.validate(selected);
+		CHECK(result.outcome == FlatValidator::INCONSISTENT);
+		CHECK(flat.getVariableAtLevel(result.level)
+				== flat.getFeatureVariable(flat.findFeature("Diesel")));
+	}
+
+	SECTION("a feature is not in the model") {
+		vector<string> selected = carProductWith("Petrol");
+		selected.push_back("Wings");
+		FlatValidator::Result result = validator.validate(selected);
+		CHECK(result.outcome == FlatValidator::UNKNOWN_FEATURE);
+		CHECK(result.feature == "Wings");
+	}
+}
+
+TEST_CASE("The report lists the invalid rows", "[FlatValidator]") {
+	const string configurations = testFile("configurations.txt");
+	const string report = testFile("report.csv");
+	vector<vector<string>> rows = carProducts();
+	rows.push_back(carProductWith("Electric"));
+	rows.back().push_back("Towbar");
+	rows.push_back(carProductWith("Petrol"));
+	rows.back().push_back("Diesel");
+	rows.push_back(carProductWith("Petrol"));
+	rows.back().push_back("Wings");
+	{
+		ofstream output(configurations);
+		output << "# products, then three invalid rows\n";
+		for (const vector<string> &row : rows) {
+			for (size_t k = 0; k < row.size(); k++)
+				output << (k > 0 ? ";" : "") << row[k];
+			output << "\n";
+		}
+	}
+	pair<uint64_t, uint64_t> outcome = FlatValidator::writeReport(carModel(), 2,
+			configurations, report);
+	CHECK(outcome.first == CAR_PRODUCTS);
+	CHECK(outcome.second == 3);
+
+	ifstream input(report);
+	vector<string> lines;
+	string line;
+	while (getline(input, line))
+		lines.push_back(line);
+	REQUIRE(lines.size() == 4);
+	CHECK(lines[1].rfind(to_string(CAR_PRODUCTS + 2) + ";", 0) == 0);
+	CHECK(lines[1].substr(lines[1].rfind(';') + 1) == "excluded");
+	CHECK(lines[2].substr(lines[2].rfind(';') + 1) == "inconsistent");
+	CHECK(lines[3].substr(lines[3].rfind(';') + 1) == "unknown feature Wings");
+}
+
+TEST_CASE("Validators of different models share a thread", "[FlatValidator]") {
+	// The larger model first: the encoding buffers of the thread must not keep its
+	// variables when they are reused for the smaller one
+	FlatValidator wide(wideModel());
+	FlatValidator car(carModel());
+	const vector<string> selected = { "f1", "f" + to_string(WIDE_VARIABLES) };
+	CHECK(wide.validate(selected).outcome != FlatValidator::UNKNOWN_FEATURE);
+	for (const vector<string> &product : carProducts())
+		CHECK(car.validate(product).outcome == FlatValidator::VALID);
+	CHECK(wide.validate(selected).outcome != FlatValidator::UNKNOWN_FEATURE);
+}
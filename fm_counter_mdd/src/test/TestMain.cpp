@@ -0,0 +1,8 @@
+/*
+ * TestMain.cpp
+ *
+ *  Created on: 18 oct 2026
+ */
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>